@@ -1,14 +1,45 @@
 # main log on/off lever
 option(ENABLE_LOGGING ON)
 
+# performance suite (obps_log_bench), needs google benchmark
+option(BUILD_BENCHMARKS "Build benchmarks" OFF)
+
+# pack message arguments in binary form on the caller side 
+#   and format them into a text in the logger thread
+option(DEFERRED_FORMATTING "Format messages in the logger thread" ON)
+
 # default queue size in messages for each log
 set(DEFAULT_QUEUE_SIZE 64)
 
-# for the memory alignment adviced to make it 2^(N) - 2 
-set(MAX_MSG_SIZE 254) # 2^(8) - 2
+# default maximum of messages that logger thread writes to an output at once
+set(DEFAULT_BATCH_SIZE 64)
+
+# default buffer size in bytes of the file descriptor sinks
+set(DEFAULT_FILE_BUFFER_SIZE 65536)
+
+# default size in bytes by which memory mapped file sinks grow the file
+set(DEFAULT_MAP_CHUNK_SIZE 4194304)
+
+# Linux file sink that writes with io_uring (kernel 5.6+), 
+#   falls back to the file descriptor sink when io_uring isn't available at runtime
+option(IO_URING_SINK "Build io_uring file sink" ON)
+
+# default number of buffers of the io_uring sink, that is writes in flight
+set(DEFAULT_URING_BUFFERS 4)
+
+# number of logger threads that serve outputs with the shared consumer
+set(DEFAULT_CONSUMER_THREADS 2)
+
+# default memory in bytes of an output's flight recorder, that keeps verbose messages until an error
+set(DEFAULT_RECORDER_SIZE 1048576)
+
+# for the memory alignment adviced to make it 2^(N) - 4 
+set(MAX_MSG_SIZE 252) # 2^(8) - 4
 
 # amout of memory that queue allocates for messages is: 
-#   QUEUE_SIZE * (sizeof(uint16_t) + MAX_MSG_SIZE) 
+#   QUEUE_SIZE * (sizeof(uint32_t) + MAX_MSG_SIZE) 
+# messages are stored as variable length records, so shorter messages take less memory
+#   and longer messages are only limited by the whole queue memory.
 
 # custom user defined levels:
 # ! keep in upper case for the sake of convention
@@ -20,3 +51,7 @@ set(OBPS_LOG_LEVELS
     DEBUG
 )
 
+# least severe level that is compiled in, calls of the levels listed after it
+#   are compiled out together with evaluation of their arguments
+#   empty: all levels are kept
+set(OBPS_LOG_MIN_LEVEL "" CACHE STRING "Least severe log level that is compiled in")
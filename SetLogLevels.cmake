@@ -3,12 +3,43 @@ set(__LOG_LEVELS "${OBPS_LOG_LEVELS}")
 string(REPLACE ";" ", " OBPS_LOG_LEVELS "${OBPS_LOG_LEVELS}")
 message("log levels: ${OBPS_LOG_LEVELS}")
 
+list(LENGTH __LOG_LEVELS __LOG_LEVELS_COUNT)
+if (__LOG_LEVELS_COUNT GREATER 64)
+    message(FATAL_ERROR "OBPS_LOG_LEVELS: at most 64 levels are supported by a level mask")
+endif()
+
+if (OBPS_LOG_MIN_LEVEL AND NOT OBPS_LOG_MIN_LEVEL IN_LIST __LOG_LEVELS)
+    message(FATAL_ERROR "OBPS_LOG_MIN_LEVEL: ${OBPS_LOG_MIN_LEVEL} is not one of the log levels: ${OBPS_LOG_LEVELS}")
+endif()
+set(__LEVEL_COMPILED_IN ON)
+
 list(APPEND OBPS_LOG_PRETTY_LEVELS "\\\n")
 foreach(level ${__LOG_LEVELS})
     list(APPEND OBPS_LOG_PRETTY_LEVELS
         "    case obps::LogLevel::${level}: return \"${level}\";\\\n"
     )
 
+    set(__LEVEL_MACROS_OFF
+        "    #define ${level}(...) {}"
+        "    #define G_${level}(...) {}"
+        "    #define ${level}_SYNC(...) {}"
+        "    #define G_${level}_SYNC(...) {}"
+        "    #define ${level}_FMT(...) {}"
+        "    #define G_${level}_FMT(...) {}"
+        "    #define ${level}_FMT_SYNC(...) {}"
+        "    #define G_${level}_FMT_SYNC(...) {}"
+    )
+    list(APPEND OBPS_LOG_MACROS_OFF__ ${__LEVEL_MACROS_OFF})
+
+    # levels after the minimum one are compiled out
+    if (NOT __LEVEL_COMPILED_IN)
+        list(APPEND OBPS_LOG_MACROS__ ${__LEVEL_MACROS_OFF})
+        continue()
+    endif()
+    if (level STREQUAL OBPS_LOG_MIN_LEVEL)
+        set(__LEVEL_COMPILED_IN OFF)
+    endif()
+
     if (level STREQUAL "DEBUG")
         list(APPEND OBPS_LOG_MACROS__ "#if defined(DEBUG_MODE) || !defined(NDEBUG)")
     endif()
@@ -18,23 +49,15 @@ foreach(level ${__LOG_LEVELS})
         "    #define G_${level}(...) get_global_log().Write(obps::LogLevel::${level}, false, __VA_ARGS__)"
         "    #define ${level}_SYNC(...) _SCOPE_LOG_ID.Write(obps::LogLevel::${level}, true, __VA_ARGS__)"
         "    #define G_${level}_SYNC(...) get_global_log().Write(obps::LogLevel::${level}, true, __VA_ARGS__)"
+        "    #define ${level}_FMT(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::${level}, false, __VA_ARGS__)"
+        "    #define G_${level}_FMT(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::${level}, false, __VA_ARGS__)"
+        "    #define ${level}_FMT_SYNC(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::${level}, true, __VA_ARGS__)"
+        "    #define G_${level}_FMT_SYNC(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::${level}, true, __VA_ARGS__)"
     )
 
     if (level STREQUAL "DEBUG")
-        list(APPEND OBPS_LOG_MACROS__ 
-            "#else" 
-            "    #define DEBUG(...) {}" 
-            "    #define G_DEBUG(...) {}" 
-            "#endif // DEBUG_MODE"
-        )
+        list(APPEND OBPS_LOG_MACROS__ "#else" ${__LEVEL_MACROS_OFF} "#endif // DEBUG_MODE")
     endif()
-        
-    list(APPEND OBPS_LOG_MACROS_OFF__ 
-        "    #define ${level}(...) {}"
-        "    #define G_${level}(...) {}"
-        "    #define ${level}_SYNC(...) {}"
-        "    #define G_${level}_SYNC(...) {}"
-    )
 endforeach()
 
 string(REPLACE ";" "\n" OBPS_LOG_MACROS__ "${OBPS_LOG_MACROS__}")
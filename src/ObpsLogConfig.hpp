@@ -7,7 +7,15 @@
 #define ObpsLog_VERSION_MINOR 
 
 #define DEFAULT_QUEUE_SIZE 64
-#define MAX_MSG_SIZE 254
+#define DEFAULT_BATCH_SIZE 64
+#define DEFAULT_FILE_BUFFER_SIZE 65536
+#define DEFAULT_MAP_CHUNK_SIZE 4194304
+#define DEFAULT_URING_BUFFERS 4
+#define DEFAULT_CONSUMER_THREADS 2
+#define DEFAULT_RECORDER_SIZE 1048576
+#define MAX_MSG_SIZE 252
+#define DEFERRED_FORMATTING
+#define IO_URING_SINK
 
 #define OBPS_LOG_LEVELS ERROR, WARN, INFO, USER_LEVEL, DEBUG
 #define OBPS_LOG_PRETTY_LEVELS \
@@ -23,46 +31,92 @@
     #define G_ERROR(...) get_global_log().Write(obps::LogLevel::ERROR, false, __VA_ARGS__)
     #define ERROR_SYNC(...) _SCOPE_LOG_ID.Write(obps::LogLevel::ERROR, true, __VA_ARGS__)
     #define G_ERROR_SYNC(...) get_global_log().Write(obps::LogLevel::ERROR, true, __VA_ARGS__)
+    #define ERROR_FMT(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::ERROR, false, __VA_ARGS__)
+    #define G_ERROR_FMT(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::ERROR, false, __VA_ARGS__)
+    #define ERROR_FMT_SYNC(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::ERROR, true, __VA_ARGS__)
+    #define G_ERROR_FMT_SYNC(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::ERROR, true, __VA_ARGS__)
     #define WARN(...) _SCOPE_LOG_ID.Write(obps::LogLevel::WARN, false, __VA_ARGS__)
     #define G_WARN(...) get_global_log().Write(obps::LogLevel::WARN, false, __VA_ARGS__)
     #define WARN_SYNC(...) _SCOPE_LOG_ID.Write(obps::LogLevel::WARN, true, __VA_ARGS__)
     #define G_WARN_SYNC(...) get_global_log().Write(obps::LogLevel::WARN, true, __VA_ARGS__)
+    #define WARN_FMT(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::WARN, false, __VA_ARGS__)
+    #define G_WARN_FMT(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::WARN, false, __VA_ARGS__)
+    #define WARN_FMT_SYNC(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::WARN, true, __VA_ARGS__)
+    #define G_WARN_FMT_SYNC(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::WARN, true, __VA_ARGS__)
     #define INFO(...) _SCOPE_LOG_ID.Write(obps::LogLevel::INFO, false, __VA_ARGS__)
     #define G_INFO(...) get_global_log().Write(obps::LogLevel::INFO, false, __VA_ARGS__)
     #define INFO_SYNC(...) _SCOPE_LOG_ID.Write(obps::LogLevel::INFO, true, __VA_ARGS__)
     #define G_INFO_SYNC(...) get_global_log().Write(obps::LogLevel::INFO, true, __VA_ARGS__)
+    #define INFO_FMT(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::INFO, false, __VA_ARGS__)
+    #define G_INFO_FMT(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::INFO, false, __VA_ARGS__)
+    #define INFO_FMT_SYNC(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::INFO, true, __VA_ARGS__)
+    #define G_INFO_FMT_SYNC(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::INFO, true, __VA_ARGS__)
     #define USER_LEVEL(...) _SCOPE_LOG_ID.Write(obps::LogLevel::USER_LEVEL, false, __VA_ARGS__)
     #define G_USER_LEVEL(...) get_global_log().Write(obps::LogLevel::USER_LEVEL, false, __VA_ARGS__)
     #define USER_LEVEL_SYNC(...) _SCOPE_LOG_ID.Write(obps::LogLevel::USER_LEVEL, true, __VA_ARGS__)
     #define G_USER_LEVEL_SYNC(...) get_global_log().Write(obps::LogLevel::USER_LEVEL, true, __VA_ARGS__)
+    #define USER_LEVEL_FMT(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::USER_LEVEL, false, __VA_ARGS__)
+    #define G_USER_LEVEL_FMT(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::USER_LEVEL, false, __VA_ARGS__)
+    #define USER_LEVEL_FMT_SYNC(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::USER_LEVEL, true, __VA_ARGS__)
+    #define G_USER_LEVEL_FMT_SYNC(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::USER_LEVEL, true, __VA_ARGS__)
 #if defined(DEBUG_MODE) || !defined(NDEBUG)
     #define DEBUG(...) _SCOPE_LOG_ID.Write(obps::LogLevel::DEBUG, false, __VA_ARGS__)
     #define G_DEBUG(...) get_global_log().Write(obps::LogLevel::DEBUG, false, __VA_ARGS__)
     #define DEBUG_SYNC(...) _SCOPE_LOG_ID.Write(obps::LogLevel::DEBUG, true, __VA_ARGS__)
     #define G_DEBUG_SYNC(...) get_global_log().Write(obps::LogLevel::DEBUG, true, __VA_ARGS__)
+    #define DEBUG_FMT(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::DEBUG, false, __VA_ARGS__)
+    #define G_DEBUG_FMT(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::DEBUG, false, __VA_ARGS__)
+    #define DEBUG_FMT_SYNC(...) OBPS_LOG_FORMAT(_SCOPE_LOG_ID, obps::LogLevel::DEBUG, true, __VA_ARGS__)
+    #define G_DEBUG_FMT_SYNC(...) OBPS_LOG_FORMAT(get_global_log(), obps::LogLevel::DEBUG, true, __VA_ARGS__)
 #else
     #define DEBUG(...) {}
     #define G_DEBUG(...) {}
+    #define DEBUG_SYNC(...) {}
+    #define G_DEBUG_SYNC(...) {}
+    #define DEBUG_FMT(...) {}
+    #define G_DEBUG_FMT(...) {}
+    #define DEBUG_FMT_SYNC(...) {}
+    #define G_DEBUG_FMT_SYNC(...) {}
 #endif // DEBUG_MODE
 #else
     #define ERROR(...) {}
     #define G_ERROR(...) {}
     #define ERROR_SYNC(...) {}
     #define G_ERROR_SYNC(...) {}
+    #define ERROR_FMT(...) {}
+    #define G_ERROR_FMT(...) {}
+    #define ERROR_FMT_SYNC(...) {}
+    #define G_ERROR_FMT_SYNC(...) {}
     #define WARN(...) {}
     #define G_WARN(...) {}
     #define WARN_SYNC(...) {}
     #define G_WARN_SYNC(...) {}
+    #define WARN_FMT(...) {}
+    #define G_WARN_FMT(...) {}
+    #define WARN_FMT_SYNC(...) {}
+    #define G_WARN_FMT_SYNC(...) {}
     #define INFO(...) {}
     #define G_INFO(...) {}
     #define INFO_SYNC(...) {}
     #define G_INFO_SYNC(...) {}
+    #define INFO_FMT(...) {}
+    #define G_INFO_FMT(...) {}
+    #define INFO_FMT_SYNC(...) {}
+    #define G_INFO_FMT_SYNC(...) {}
     #define USER_LEVEL(...) {}
     #define G_USER_LEVEL(...) {}
     #define USER_LEVEL_SYNC(...) {}
     #define G_USER_LEVEL_SYNC(...) {}
+    #define USER_LEVEL_FMT(...) {}
+    #define G_USER_LEVEL_FMT(...) {}
+    #define USER_LEVEL_FMT_SYNC(...) {}
+    #define G_USER_LEVEL_FMT_SYNC(...) {}
     #define DEBUG(...) {}
     #define G_DEBUG(...) {}
     #define DEBUG_SYNC(...) {}
     #define G_DEBUG_SYNC(...) {}
+    #define DEBUG_FMT(...) {}
+    #define G_DEBUG_FMT(...) {}
+    #define DEBUG_FMT_SYNC(...) {}
+    #define G_DEBUG_FMT_SYNC(...) {}
 #endif //LOG_ON
@@ -0,0 +1,256 @@
+#include "benchmark/benchmark.h"
+
+#include "obps_log_public.hpp"
+
+#include <algorithm> // std::sort, std::max
+#include <chrono> // std::chrono::steady_clock
+#include <filesystem> // std::filesystem
+#include <format> // std::format
+#include <fstream> // std::filebuf
+#include <map> // std::map
+#include <memory> // std::unique_ptr
+#include <mutex> // std::mutex
+#include <streambuf> // std::streambuf
+#include <string> // std::string
+#include <thread> // std::thread
+#include <tuple> // std::tuple
+#include <vector> // std::vector
+
+namespace fs = std::filesystem;
+
+using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+using FileSpecs = obps::Log::LogSpecs::FileSpecs;
+
+namespace
+{
+
+// the most severe level passes any output, whatever levels are configured
+constexpr auto bench_level = obps::LogLevel{};
+
+// messages written by a producer before it waits for the output to catch up
+constexpr int64_t burst_size = 1024;
+
+const int max_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+const fs::path bench_dir = fs::current_path() / "bench_logs";
+
+// Discards output, optionally passing it to another buffer.
+// Logger thread writes whole batches, so only xsputn needs to be fast.
+class DiscardingBuffer final : public std::streambuf
+{
+public:
+    explicit DiscardingBuffer(std::streambuf* next = nullptr) : m_Next(next) {}
+
+protected:
+    std::streamsize xsputn(const char* data, const std::streamsize size) override
+    {
+        return m_Next ? m_Next->sputn(data, size) : size;
+    }
+
+    int_type overflow(const int_type ch) override
+    {
+        return m_Next ? m_Next->sputc(static_cast<char>(ch)) : ch;
+    }
+
+    int sync() override
+    {
+        return m_Next ? m_Next->pubsync() : 0;
+    }
+
+private:
+    std::streambuf* m_Next;
+};
+
+enum class Sink
+{
+    NUL,    // lines are discarded
+    STREAM, // std::ostream over a file buffer of /dev/null
+    FILE    // FileSink of a log file
+};
+
+// Logs are created once per configuration and kept until teardown:
+//  logger threads of an output run until the log registry shuts down.
+struct BenchLog
+{
+    std::unique_ptr<std::filebuf> DevNull;
+    std::unique_ptr<DiscardingBuffer> Discard;
+    std::unique_ptr<std::ostream> Stream;
+    std::unique_ptr<obps::Log> Log;
+
+    // waits until the sink received all lines written so far
+    void Drain() const
+    {
+        Log->Flush();
+    }
+};
+
+BenchLog& GetBenchLog(const Sink sink, const size_t queue_size, const obps::LogQueue::Mode mode = obps::LogQueue::Mode::SHARED)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<Sink, size_t, obps::LogQueue::Mode>, std::unique_ptr<BenchLog>> logs;
+
+    std::lock_guard lock(mutex);
+    auto& log = logs[{sink, queue_size, mode}];
+    if (log)
+    {
+        return *log;
+    }
+
+    log = std::make_unique<BenchLog>();
+    if (sink == Sink::FILE)
+    {
+        fs::create_directories(bench_dir);
+        log->Log = std::make_unique<obps::Log>(obps::Log::LogSpecs{
+            OutputSpecs(bench_level, bench_dir / std::format("bench-{}-{}", queue_size, static_cast<int>(mode)), queue_size)
+                .SetQueueMode(mode)
+                .SetFileSpecs({.SinkType = FileSpecs::Sink::FD})});
+        return *log;
+    }
+
+    if (sink == Sink::STREAM)
+    {
+        log->DevNull = std::make_unique<std::filebuf>();
+        log->DevNull->open("/dev/null", std::ios::out);
+    }
+    log->Discard = std::make_unique<DiscardingBuffer>(log->DevNull.get());
+    log->Stream = std::make_unique<std::ostream>(log->Discard.get());
+    log->Log = std::make_unique<obps::Log>(obps::Log::LogSpecs{
+        OutputSpecs(bench_level, *log->Stream, queue_size).SetQueueMode(mode)});
+    return *log;
+}
+
+size_t QueueSize(const benchmark::State& state)
+{
+    return static_cast<size_t>(state.range(0));
+}
+
+// Time that a producer spends in a single Write call, reported as percentiles.
+// Counters of producer threads are averaged.
+void BM_WriteLatency(benchmark::State& state)
+{
+    auto& bench = GetBenchLog(Sink::NUL, QueueSize(state));
+
+    std::vector<int64_t> latencies;
+    latencies.reserve(1 << 20);
+    int64_t i = 0;
+    for (auto _ : state)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        bench.Log->Write(bench_level, false, "latency of a message ", i++, ' ', 3.14);
+        const auto end = std::chrono::steady_clock::now();
+        if (latencies.size() < latencies.capacity())
+        {
+            latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+    }
+    bench.Drain();
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](const double p){
+        return latencies.empty() ? 0.0 : static_cast<double>(latencies[static_cast<size_t>(p * (latencies.size() - 1))]);
+    };
+    state.counters["p50_ns"] = benchmark::Counter(percentile(0.5), benchmark::Counter::kAvgThreads);
+    state.counters["p99_ns"] = benchmark::Counter(percentile(0.99), benchmark::Counter::kAvgThreads);
+    state.counters["p99.9_ns"] = benchmark::Counter(percentile(0.999), benchmark::Counter::kAvgThreads);
+    state.counters["max_ns"] = benchmark::Counter(percentile(1.0), benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(BM_WriteLatency)
+    ->RangeMultiplier(4)->Range(obps::LogRegistry::default_queue_size, obps::LogRegistry::default_queue_size * 64)
+    ->ThreadRange(1, max_threads)
+    ->UseRealTime();
+
+// Messages per second from producers to the output. Each iteration is a burst of messages,
+//  after which the producer waits until the sink receives everything written so far.
+template <Sink sink, obps::LogQueue::Mode mode = obps::LogQueue::Mode::SHARED>
+void BM_Throughput(benchmark::State& state)
+{
+    auto& bench = GetBenchLog(sink, QueueSize(state), mode);
+
+    int64_t i = 0;
+    for (auto _ : state)
+    {
+        for (int64_t burst = 0; burst < burst_size; burst++)
+        {
+            bench.Log->Write(bench_level, false, "throughput of a message ", i++);
+        }
+        bench.Drain();
+    }
+    state.SetItemsProcessed(state.iterations() * burst_size);
+}
+
+#define OBPS_LOG_THROUGHPUT(...) \
+    BENCHMARK_TEMPLATE(BM_Throughput, __VA_ARGS__) \
+        ->RangeMultiplier(4)->Range(obps::LogRegistry::default_queue_size, obps::LogRegistry::default_queue_size * 64) \
+        ->ThreadRange(1, max_threads) \
+        ->UseRealTime()
+
+OBPS_LOG_THROUGHPUT(Sink::NUL);
+OBPS_LOG_THROUGHPUT(Sink::STREAM);
+OBPS_LOG_THROUGHPUT(Sink::FILE);
+OBPS_LOG_THROUGHPUT(Sink::NUL, obps::LogQueue::Mode::PER_THREAD);
+
+// Producer cost of the argument kinds, with a queue that is large enough to not block
+void BM_Arguments_Literal(benchmark::State& state)
+{
+    auto& bench = GetBenchLog(Sink::NUL, obps::LogRegistry::default_queue_size * 64);
+    for (auto _ : state)
+    {
+        bench.Log->Write(bench_level, false, "a message without arguments");
+    }
+    bench.Drain();
+}
+BENCHMARK(BM_Arguments_Literal);
+
+void BM_Arguments_Numbers(benchmark::State& state)
+{
+    auto& bench = GetBenchLog(Sink::NUL, obps::LogRegistry::default_queue_size * 64);
+    int64_t i = 0;
+    for (auto _ : state)
+    {
+        bench.Log->Write(bench_level, false, "numbers ", i, ' ', 2.5 * i, ' ', static_cast<uint8_t>(i));
+        ++i;
+    }
+    bench.Drain();
+}
+BENCHMARK(BM_Arguments_Numbers);
+
+void BM_Arguments_String(benchmark::State& state)
+{
+    auto& bench = GetBenchLog(Sink::NUL, obps::LogRegistry::default_queue_size * 64);
+    const std::string text(state.range(0), 's');
+    for (auto _ : state)
+    {
+        bench.Log->Write(bench_level, false, "string ", text);
+    }
+    bench.Drain();
+}
+BENCHMARK(BM_Arguments_String)->RangeMultiplier(4)->Range(8, 128);
+
+void BM_Arguments_Format(benchmark::State& state)
+{
+    auto& bench = GetBenchLog(Sink::NUL, obps::LogRegistry::default_queue_size * 64);
+    auto& log = *bench.Log;
+    int64_t i = 0;
+    for (auto _ : state)
+    {
+        OBPS_LOG_FORMAT(log, bench_level, false, "format {} of {:.2f}", i++, 2.5);
+    }
+    bench.Drain();
+}
+BENCHMARK(BM_Arguments_Format);
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    OBPS_LOG_TEARDOWN();
+    return 0;
+}
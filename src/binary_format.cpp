@@ -0,0 +1,279 @@
+#include "binary_format.hpp"
+
+#include <algorithm> // std::min
+#include <cstring> // std::memcpy, std::memcmp
+#include <sstream> // std::ostringstream
+#include <stdexcept> // std::runtime_error
+#include <string_view> // std::string_view
+#include <unordered_map> // std::unordered_map
+
+#include "message_args.hpp"
+
+namespace obps
+{
+
+namespace
+{
+
+constexpr char binary_magic[8] = {'O', 'B', 'P', 'S', 'B', 'L', 'O', 'G'};
+constexpr uint16_t binary_version = 1;
+constexpr uint32_t byte_order_mark = 0x01020304;
+
+// everything that the layout of packed args and message records depends on
+struct BinaryHeader
+{
+    char Magic[sizeof(binary_magic)];
+    uint32_t ByteOrderMark;
+    uint16_t Version;
+    uint8_t LongSize;
+    uint8_t LongDoubleSize;
+    uint8_t PointerSize;
+    uint8_t ThreadIdSize;
+    uint16_t Reserved;
+};
+static_assert(sizeof(BinaryHeader) == 20, "header is compared bytewise and must have no padding");
+
+BinaryHeader NativeHeader() noexcept
+{
+    BinaryHeader header{};
+    std::memcpy(header.Magic, binary_magic, sizeof(binary_magic));
+    header.Version = binary_version;
+    header.LongSize = sizeof(long);
+    header.LongDoubleSize = sizeof(long double);
+    header.PointerSize = sizeof(void*);
+    header.ThreadIdSize = sizeof(std::thread::id);
+    header.ByteOrderMark = byte_order_mark;
+    return header;
+}
+
+constexpr size_t message_header_size = sizeof(int64_t) + sizeof(uint8_t) + sizeof(std::thread::id) + sizeof(uint32_t);
+
+template <typename T>
+void Put(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(std::ostream& out, const std::string_view str)
+{
+    Put(out, static_cast<uint32_t>(str.size()));
+    out.write(str.data(), str.size());
+}
+
+// appends values to a fixed buffer, remembers if any of them didn't fit
+class BufferWriter
+{
+public:
+    BufferWriter(char* const buffer, const size_t capacity) noexcept
+        : m_Buffer(buffer)
+        , m_Capacity(capacity)
+    {}
+
+    void Write(const void* const data, const size_t size) noexcept
+    {
+        if (m_Capacity - m_Size < size)
+        {
+            m_Overflow = true;
+            return;
+        }
+        std::memcpy(m_Buffer + m_Size, data, size);
+        m_Size += size;
+    }
+
+    template <typename T>
+    void Put(const T& value) noexcept
+    {
+        Write(&value, sizeof(value));
+    }
+
+    void PutString(const std::string_view str) noexcept
+    {
+        Put(static_cast<uint32_t>(str.size()));
+        Write(str.data(), str.size());
+    }
+
+    size_t GetSize() const noexcept
+    {
+        return m_Overflow ? 0 : m_Size;
+    }
+
+private:
+    char* const m_Buffer;
+    const size_t m_Capacity;
+    size_t m_Size = 0;
+    bool m_Overflow = false;
+};
+
+template <typename T>
+T Get(const char*& cursor) noexcept
+{
+    T value;
+    std::memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    return value;
+}
+
+} // namespace
+
+std::string MakeBinaryHeader()
+{
+    const auto header = NativeHeader();
+    const uint32_t size = sizeof(BinaryRecord) + sizeof(header);
+
+    std::string record;
+    record.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    record.push_back(static_cast<char>(BinaryRecord::HEADER));
+    record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    return record;
+}
+
+void BinaryEncoder::WriteMessage(std::ostream& out, const TimeStamp timestamp, const LogLevel level, const std::thread::id tid,
+    const CallSite* const site, const char* const args, const size_t args_size)
+{
+    const uint32_t id = site ? site->GetId() : 0;
+    if (site && (id >= m_Described.size() || ! m_Described[id]))
+    {
+        WriteFormat(out, id, *site);
+    }
+
+    Put(out, static_cast<uint32_t>(sizeof(BinaryRecord) + message_header_size + args_size));
+    Put(out, BinaryRecord::MESSAGE);
+    Put(out, static_cast<int64_t>(timestamp.time_since_epoch().count()));
+    Put(out, static_cast<uint8_t>(level));
+    Put(out, tid);
+    Put(out, id);
+    out.write(args, args_size);
+}
+
+size_t BinaryEncoder::EncodeMessage(char* const buffer, const size_t capacity, const TimeStamp timestamp, const LogLevel level, 
+    const std::thread::id tid, const CallSite* const site, const char* const args, const size_t args_size) const noexcept
+{
+    BufferWriter out(buffer, capacity);
+    const uint32_t id = site ? site->GetId() : 0;
+    if (site && (id >= m_Described.size() || ! m_Described[id]))
+    {
+        const std::string_view file = site->File;
+        out.Put(static_cast<uint32_t>(sizeof(BinaryRecord) + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t) 
+            + sizeof(uint32_t) + file.size() + sizeof(uint32_t) + site->Format.size()));
+        out.Put(BinaryRecord::FORMAT);
+        out.Put(id);
+        out.Put(static_cast<uint8_t>(site->Level));
+        out.Put(site->Line);
+        out.PutString(file);
+        out.PutString(site->Format);
+    }
+
+    out.Put(static_cast<uint32_t>(sizeof(BinaryRecord) + message_header_size + args_size));
+    out.Put(BinaryRecord::MESSAGE);
+    out.Put(static_cast<int64_t>(timestamp.time_since_epoch().count()));
+    out.Put(static_cast<uint8_t>(level));
+    out.Put(tid);
+    out.Put(id);
+    out.Write(args, args_size);
+    return out.GetSize();
+}
+
+std::string BinaryEncoder::MakeFileHeader() const
+{
+    return MakeBinaryHeader() + m_Formats;
+}
+
+void BinaryEncoder::WriteFormat(std::ostream& out, const uint32_t id, const CallSite& site)
+{
+    const std::string_view file = site.File;
+    std::ostringstream record;
+    Put(record, static_cast<uint32_t>(sizeof(BinaryRecord) + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t) 
+        + sizeof(uint32_t) + file.size() + sizeof(uint32_t) + site.Format.size()));
+    Put(record, BinaryRecord::FORMAT);
+    Put(record, id);
+    Put(record, static_cast<uint8_t>(site.Level));
+    Put(record, site.Line);
+    PutString(record, file);
+    PutString(record, site.Format);
+
+    const auto bytes = record.view();
+    out.write(bytes.data(), bytes.size());
+    m_Formats.append(bytes);
+
+    if (id >= m_Described.size())
+    {
+        m_Described.resize(id + 1);
+    }
+    m_Described[id] = true;
+}
+
+size_t DecodeBinaryLog(std::istream& in, std::ostream& out, const MessageData::FormatFunctionPtr format)
+{
+    std::vector<char> record;
+    std::unordered_map<uint32_t, std::string> formats;
+    size_t messages = 0;
+    bool has_header = false;
+
+    uint32_t size;
+    while (in.read(reinterpret_cast<char*>(&size), sizeof(size)))
+    {
+        if (! has_header && size != sizeof(BinaryRecord) + sizeof(BinaryHeader))
+        {
+            throw std::runtime_error("Not a binary log!");
+        }
+
+        record.resize(size);
+        if (size == 0 || ! in.read(record.data(), size))
+        {
+            break;
+        }
+
+        const char* cursor = record.data();
+        const auto kind = Get<BinaryRecord>(cursor);
+        if (kind == BinaryRecord::HEADER)
+        {
+            const auto native = NativeHeader();
+            if (size != sizeof(BinaryRecord) + sizeof(BinaryHeader) || std::memcmp(cursor, binary_magic, sizeof(binary_magic)) != 0)
+            {
+                throw std::runtime_error("Not a binary log!");
+            }
+            if (std::memcmp(cursor, &native, sizeof(native)) != 0)
+            {
+                throw std::runtime_error("Binary log has been written by an incompatible version or platform!");
+            }
+            has_header = true;
+            formats.clear(); // call site ids are numbered by each writing process
+        }
+        else if (! has_header)
+        {
+            throw std::runtime_error("Not a binary log!");
+        }
+        else if (kind == BinaryRecord::MESSAGE && size >= sizeof(BinaryRecord) + message_header_size)
+        {
+            const auto timestamp = TimeStamp(std::chrono::nanoseconds(Get<int64_t>(cursor)));
+            const auto level = static_cast<LogLevel>(Get<uint8_t>(cursor));
+            const auto tid = Get<std::thread::id>(cursor);
+            const auto id = Get<uint32_t>(cursor);
+            const size_t args_size = record.data() + size - cursor;
+
+            const auto site_format = formats.find(id);
+            format(out, timestamp, level, tid, site_format != formats.end()
+                ? FormatPackedArgs(site_format->second, cursor, args_size)
+                : UnpackArgs(cursor, args_size, false));
+            messages++;
+        }
+        else if (kind == BinaryRecord::FORMAT && size >= sizeof(BinaryRecord) + 3 * sizeof(uint32_t) + sizeof(uint8_t))
+        {
+            const auto end = record.data() + size;
+            const auto id = Get<uint32_t>(cursor);
+            cursor += sizeof(uint8_t) + sizeof(uint32_t); // level, line
+            
+            const auto file_length = std::min<size_t>(Get<uint32_t>(cursor), end - cursor);
+            cursor += file_length;
+            if (static_cast<size_t>(end - cursor) >= sizeof(uint32_t))
+            {
+                const auto format_length = std::min<size_t>(Get<uint32_t>(cursor), end - cursor);
+                formats[id].assign(cursor, format_length);
+            }
+        }
+    }
+
+    return messages;
+}
+
+} // namespace obps
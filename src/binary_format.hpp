@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint> // uint8_t, uint32_t
+#include <istream> // std::istream
+#include <ostream> // std::ostream
+#include <memory> // std::shared_ptr
+#include <string> // std::string
+#include <vector> // std::vector
+
+#include "ObpsLogConfig.hpp"
+#include "message_data.hpp"
+#include "message_format.hpp"
+
+namespace obps
+{
+
+// Binary encoding of log messages, which moves text formatting out of the process (see obps_log_decode).
+// Output is a sequence of records in the native byte order: [uint32_t size][BinaryRecord kind][payload],
+//  size counts kind and payload.
+//  HEADER:  [magic "OBPSBLOG"][uint32_t byte order mark][uint16_t version]
+//           [uint8_t sizes of long, long double, pointer, std::thread::id][uint16_t reserved]
+//           starts each binary output, appending to an existing file adds another one.
+//  MESSAGE: [int64_t nanoseconds since epoch][uint8_t level][std::thread::id][uint32_t format id][packed args]
+//           format id 0: arguments are streamed one by one (see UnpackArgs),
+//           otherwise they are formatted by the format string of the call site with this id.
+//  FORMAT:  [uint32_t format id][uint8_t level][uint32_t line][uint32_t length][file][uint32_t length][format]
+//           describes a call site before its first message in the output.
+// Unknown record kinds are skipped by the decoder.
+enum class BinaryRecord : uint8_t
+{
+    HEADER,
+    MESSAGE,
+    FORMAT
+};
+
+std::string MakeBinaryHeader();
+
+// Writes messages of a single output, remembering which call sites have been described in it
+class BinaryEncoder
+{
+public:
+    void WriteMessage(std::ostream& out, TimeStamp timestamp, LogLevel level, std::thread::id tid, 
+        const CallSite* site, const char* args, size_t args_size);
+
+    // Async-signal-safe WriteMessage into a buffer, for the crash handler.
+    // Call site that hasn't been described is described by the buffer, without remembering it.
+    // Return: size of the encoded records, 0 if they don't fit into the capacity
+    size_t EncodeMessage(char* buffer, size_t capacity, TimeStamp timestamp, LogLevel level, std::thread::id tid, 
+        const CallSite* site, const char* args, size_t args_size) const noexcept;
+
+    // Header of another file of the output: the binary header followed by FORMAT records
+    //  of the call sites described so far, as the decoder forgets them at each header.
+    std::string MakeFileHeader() const;
+
+private:
+    void WriteFormat(std::ostream& out, uint32_t id, const CallSite& site);
+
+    std::vector<bool> m_Described;
+    std::string m_Formats; // FORMAT records written so far
+};
+
+using BinaryEncoderSptr = std::shared_ptr<BinaryEncoder>;
+
+// Converts binary log into text with a given format function.
+// Throws std::runtime_error when the input is not a binary log or has been written on an incompatible platform,
+// a record cut by the end of the input is ignored.
+// Return: number of decoded messages
+size_t DecodeBinaryLog(std::istream& in, std::ostream& out, MessageData::FormatFunctionPtr format);
+
+} // namespace obps
@@ -0,0 +1,693 @@
+#include "crash_handler.hpp"
+
+#include <algorithm> // std::min
+#include <cerrno> // errno
+#include <charconv> // std::to_chars, std::from_chars
+#include <csignal> // sigaction, raise, NSIG
+#include <cstdint> // uint32_t, uintptr_t
+#include <cstring> // std::memcpy, std::strerror
+#include <ctime> // std::time, localtime_r
+#include <format> // std::format
+#include <iostream> // std::cerr
+#include <mutex> // std::mutex, std::lock_guard
+#include <stdexcept> // std::invalid_argument, std::runtime_error
+#include <string_view> // std::string_view
+#include <type_traits> // std::make_unsigned_t, std::is_same_v
+#include <utility> // std::exchange
+
+#include <sys/syscall.h> // SYS_gettid
+#include <unistd.h> // syscall, pause
+
+#include "log_queue.hpp"
+#include "message_args.hpp"
+
+namespace obps
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// records are formatted into a static buffer, the handler allocates nothing;
+// messages that don't fit into it are skipped
+constexpr size_t crash_buffer_size = 64 * 1024;
+char s_Buffer[crash_buffer_size];
+
+std::mutex s_Mutex; // guards installation and the list of outputs
+bool s_Active = false; // the handler has been installed for some signal
+bool s_CapReported = false;
+bool s_Installed[NSIG] = {};
+struct sigaction s_Previous[NSIG];
+std::atomic<long> s_UtcOffset = 0; // seconds east of UTC when the handler was installed
+std::atomic<pid_t> s_DrainingThread = 0;
+
+// indexes of the manipulators packed by ArgsPacker (standard_manipulators of message_args.cpp)
+enum StandardManipulator : uint8_t
+{
+    BOOLALPHA, NOBOOLALPHA,
+    SHOWBASE, NOSHOWBASE,
+    SHOWPOINT, NOSHOWPOINT,
+    SHOWPOS, NOSHOWPOS,
+    SKIPWS, NOSKIPWS,
+    UPPERCASE, NOUPPERCASE,
+    UNITBUF, NOUNITBUF,
+    INTERNAL, LEFT, RIGHT,
+    DEC, HEX, OCT,
+    FIXED, SCIENTIFIC, HEXFLOAT, DEFAULTFLOAT
+};
+
+// format flags that affect the text of an argument
+struct ArgFormat
+{
+    int Base = 10;
+    bool BoolAlpha = false;
+    bool ShowBase = false;
+    bool Uppercase = false;
+    std::chars_format Float = std::chars_format::general;
+    int Precision = 6;       // -1: shortest representation
+    bool FormatCall = false; // argument of a format string, otherwise streamed
+};
+
+// Appends text to a fixed buffer, text that doesn't fit is cut.
+class LineWriter
+{
+public:
+    LineWriter(char* const buffer, const size_t capacity) noexcept
+        : m_Begin(buffer)
+        , m_Cursor(buffer)
+        , m_End(buffer + capacity)
+    {}
+
+    void Put(const char c) noexcept
+    {
+        if (m_Cursor == m_End)
+        {
+            m_Cut = true;
+            return;
+        }
+        *m_Cursor++ = c;
+    }
+
+    void Put(const std::string_view text, const bool uppercase = false) noexcept
+    {
+        for (const char c : text)
+        {
+            Put(uppercase && c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c);
+        }
+    }
+
+    bool Cut() const noexcept
+    {
+        return m_Cut;
+    }
+
+    size_t Size() const noexcept
+    {
+        return m_Cursor - m_Begin;
+    }
+
+private:
+    char* const m_Begin;
+    char* m_Cursor;
+    char* const m_End;
+    bool m_Cut = false;
+};
+
+template <typename ...Args>
+void PutChars(LineWriter& out, const bool uppercase, const Args ...args) noexcept
+{
+    char digits[512];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), args...);
+    if (result.ec == std::errc{})
+    {
+        out.Put(std::string_view(digits, result.ptr - digits), uppercase);
+    }
+}
+
+void PutPadded(LineWriter& out, const unsigned value, const unsigned width) noexcept
+{
+    char digits[16];
+    const auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    for (auto length = static_cast<unsigned>(end - digits); length < width; ++length)
+    {
+        out.Put('0');
+    }
+    out.Put(std::string_view(digits, end - digits));
+}
+
+template <typename T>
+void PutInteger(LineWriter& out, const T value, const ArgFormat& format) noexcept
+{
+    if (format.Base == 10)
+    {
+        PutChars(out, false, value);
+        return;
+    }
+
+    // streams print values of other bases as unsigned
+    const auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    if (format.ShowBase && bits != 0)
+    {
+        switch (format.Base)
+        {
+            case 16: out.Put(format.Uppercase ? "0X" : "0x"); break;
+            case 2:  out.Put(format.Uppercase ? "0B" : "0b"); break;
+            default: out.Put('0');
+        }
+    }
+    PutChars(out, format.Uppercase, bits, format.Base);
+}
+
+template <typename T>
+void PutFloat(LineWriter& out, const T value, const ArgFormat& format) noexcept
+{
+    const auto hex = format.Float == std::chars_format::hex;
+    if (hex && ! format.FormatCall)
+    {
+        // streams ignore precision of hexfloat and print its prefix
+        out.Put(format.Uppercase ? "0X" : "0x");
+        PutChars(out, format.Uppercase, value, format.Float);
+    }
+    else if (format.Precision >= 0)
+    {
+        PutChars(out, format.Uppercase, value, format.Float, format.Precision);
+    }
+    else if (format.Float == std::chars_format::general)
+    {
+        PutChars(out, format.Uppercase, value);
+    }
+    else
+    {
+        PutChars(out, format.Uppercase, value, format.Float);
+    }
+}
+
+template <typename T>
+bool PutValue(LineWriter& out, const char*& cursor, const char* const end, const ArgFormat& format) noexcept
+{
+    T value;
+    if (static_cast<size_t>(end - cursor) < sizeof(value))
+    {
+        return false;
+    }
+
+    std::memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        out.Put(format.BoolAlpha ? (value ? "true" : "false") : (value ? "1" : "0"));
+    }
+    else if constexpr (std::is_same_v<T, char>)
+    {
+        out.Put(value);
+    }
+    else if constexpr (std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>)
+    {
+        // streamed as characters, formatted as numbers
+        if (format.FormatCall)
+        {
+            PutInteger(out, static_cast<int>(value), format);
+        }
+        else
+        {
+            out.Put(static_cast<char>(value));
+        }
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        PutFloat(out, value, format);
+    }
+    else if constexpr (std::is_pointer_v<T>)
+    {
+        const auto address = reinterpret_cast<uintptr_t>(value);
+        if (address == 0 && ! format.FormatCall)
+        {
+            out.Put('0');
+            return true;
+        }
+        out.Put("0x");
+        PutChars(out, false, address, 16);
+    }
+    else
+    {
+        PutInteger(out, value, format);
+    }
+    return true;
+}
+
+void ApplyManipulator(ArgFormat& format, const uint8_t index) noexcept
+{
+    switch (index)
+    {
+        case BOOLALPHA:    format.BoolAlpha = true; break;
+        case NOBOOLALPHA:  format.BoolAlpha = false; break;
+        case SHOWBASE:     format.ShowBase = true; break;
+        case NOSHOWBASE:   format.ShowBase = false; break;
+        case UPPERCASE:    format.Uppercase = true; break;
+        case NOUPPERCASE:  format.Uppercase = false; break;
+        case DEC:          format.Base = 10; break;
+        case HEX:          format.Base = 16; break;
+        case OCT:          format.Base = 8; break;
+        case FIXED:        format.Float = std::chars_format::fixed; break;
+        case SCIENTIFIC:   format.Float = std::chars_format::scientific; break;
+        case HEXFLOAT:     format.Float = std::chars_format::hex; break;
+        case DEFAULTFLOAT: format.Float = std::chars_format::general; break;
+        default: // layout manipulators don't change the text of values
+            break;
+    }
+}
+
+bool SkipValue(const char*& cursor, const char* const end, const size_t size) noexcept
+{
+    if (static_cast<size_t>(end - cursor) < size)
+    {
+        return false;
+    }
+
+    cursor += size;
+    return true;
+}
+
+bool PutString(LineWriter& out, const char*& cursor, const char* const end) noexcept
+{
+    uint32_t length;
+    if (static_cast<size_t>(end - cursor) < sizeof(length))
+    {
+        return false;
+    }
+
+    std::memcpy(&length, cursor, sizeof(length));
+    cursor += sizeof(length);
+
+    const auto available = std::min<size_t>(length, end - cursor);
+    out.Put(std::string_view(cursor, available));
+    cursor += available;
+    return true;
+}
+
+// async-signal-safe counterpart of UnpackArgs for a single argument, returns false if it is cut by the end
+bool PutArg(LineWriter& out, const char*& cursor, const char* const end, ArgFormat& format) noexcept
+{
+    switch (static_cast<ArgTag>(*cursor++))
+    {
+        case ArgTag::BOOL:    return PutValue<bool>(out, cursor, end, format);
+        case ArgTag::CHAR:    return PutValue<char>(out, cursor, end, format);
+        case ArgTag::SCHAR:   return PutValue<signed char>(out, cursor, end, format);
+        case ArgTag::UCHAR:   return PutValue<unsigned char>(out, cursor, end, format);
+        case ArgTag::SHORT:   return PutValue<short>(out, cursor, end, format);
+        case ArgTag::USHORT:  return PutValue<unsigned short>(out, cursor, end, format);
+        case ArgTag::INT:     return PutValue<int>(out, cursor, end, format);
+        case ArgTag::UINT:    return PutValue<unsigned int>(out, cursor, end, format);
+        case ArgTag::LONG:    return PutValue<long>(out, cursor, end, format);
+        case ArgTag::ULONG:   return PutValue<unsigned long>(out, cursor, end, format);
+        case ArgTag::LLONG:   return PutValue<long long>(out, cursor, end, format);
+        case ArgTag::ULLONG:  return PutValue<unsigned long long>(out, cursor, end, format);
+        case ArgTag::FLOAT:   return PutValue<float>(out, cursor, end, format);
+        case ArgTag::DOUBLE:  return PutValue<double>(out, cursor, end, format);
+        case ArgTag::LDOUBLE: return PutValue<long double>(out, cursor, end, format);
+        case ArgTag::POINTER: return PutValue<const void*>(out, cursor, end, format);
+        case ArgTag::STRING:  return PutString(out, cursor, end);
+        case ArgTag::MANIPULATOR:
+            if (cursor == end)
+            {
+                return false;
+            }
+            ApplyManipulator(format, static_cast<uint8_t>(*cursor++));
+            return true;
+        case ArgTag::USER_MANIPULATOR:
+            return SkipValue(cursor, end, sizeof(IosManipulator));
+        default:
+            return false; // corrupted message, keep what has been formatted
+    }
+}
+
+// format of a replacement field, only presentation type and precision of its spec are applied
+ArgFormat FieldFormat(std::string_view field) noexcept
+{
+    ArgFormat format{.BoolAlpha = true, .Precision = -1, .FormatCall = true};
+    const auto colon = field.find(':');
+    if (colon == std::string_view::npos)
+    {
+        return format;
+    }
+
+    const auto spec = field.substr(colon + 1);
+    format.ShowBase = spec.find('#') != std::string_view::npos;
+    if (const auto dot = spec.find('.'); dot != std::string_view::npos)
+    {
+        std::from_chars(spec.data() + dot + 1, spec.data() + spec.size(), format.Precision);
+    }
+
+    const auto type = spec.empty() ? '\0' : spec.back();
+    switch (type)
+    {
+        case 'x': case 'X': format.Base = 16; break;
+        case 'o':           format.Base = 8; break;
+        case 'b': case 'B': format.Base = 2; break;
+        case 'e': case 'E': format.Float = std::chars_format::scientific; break;
+        case 'f': case 'F': format.Float = std::chars_format::fixed; break;
+        case 'g': case 'G': format.Float = std::chars_format::general; break;
+        case 'a': case 'A': format.Float = std::chars_format::hex; break;
+        default:
+            return format;
+    }
+
+    format.Uppercase = type >= 'A' && type <= 'Z';
+    if (format.Precision < 0 && (type == 'e' || type == 'E' || type == 'f' || type == 'F' || type == 'g' || type == 'G'))
+    {
+        format.Precision = 6;
+    }
+    return format;
+}
+
+// replaces fields of the format string by the arguments one by one, field indexes are ignored
+void PutFormatted(LineWriter& out, const std::string_view format, const char* cursor, const char* const end) noexcept
+{
+    size_t pos = 0;
+    while (pos < format.size())
+    {
+        const char c = format[pos++];
+        if ((c == '{' || c == '}') && pos < format.size() && format[pos] == c)
+        {
+            out.Put(c);
+            ++pos;
+            continue;
+        }
+        if (c != '{')
+        {
+            out.Put(c);
+            continue;
+        }
+
+        // nested fields of dynamic width and precision take the arguments that follow the value
+        size_t close = pos;
+        size_t nested = 0;
+        while (close < format.size() && format[close] != '}')
+        {
+            if (format[close] == '{')
+            {
+                ++nested;
+                close = format.find('}', close);
+            }
+            close += close < format.size();
+        }
+        if (close >= format.size())
+        {
+            return;
+        }
+        auto arg_format = FieldFormat(format.substr(pos, close - pos));
+        pos = close + 1;
+        if (cursor < end && ! PutArg(out, cursor, end, arg_format))
+        {
+            return;
+        }
+
+        LineWriter skipped(nullptr, 0);
+        for (; nested > 0 && cursor < end; --nested)
+        {
+            if (! PutArg(skipped, cursor, end, arg_format))
+            {
+                return;
+            }
+        }
+    }
+}
+
+// local time by the UTC offset taken at installation, localtime_r isn't async-signal-safe
+void PutTimestamp(LineWriter& out, const TimeStamp timestamp) noexcept
+{
+    const auto ns = timestamp.time_since_epoch().count();
+    const auto utc_seconds = ns / 1'000'000'000 - (ns % 1'000'000'000 < 0);
+    const auto microseconds = static_cast<unsigned>((ns - utc_seconds * 1'000'000'000) / 1000);
+    const int64_t seconds = utc_seconds + s_UtcOffset.load(std::memory_order_relaxed);
+
+    int64_t days = seconds / 86400 - (seconds % 86400 < 0);
+    const auto time_of_day = static_cast<unsigned>(seconds - days * 86400);
+
+    // civil date from days since 1970-01-01, proleptic gregorian calendar
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const auto day_of_era = static_cast<unsigned>(days - era * 146097);
+    const unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const unsigned shifted_month = (5 * day_of_year + 2) / 153;
+    const unsigned day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+    const unsigned month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+    const auto year = static_cast<unsigned>(year_of_era + era * 400 + (month <= 2));
+
+    PutPadded(out, year, 4);
+    out.Put('-');
+    PutPadded(out, month, 2);
+    out.Put('-');
+    PutPadded(out, day, 2);
+    out.Put(' ');
+    PutPadded(out, time_of_day / 3600, 2);
+    out.Put(':');
+    PutPadded(out, time_of_day / 60 % 60, 2);
+    out.Put(':');
+    PutPadded(out, time_of_day % 60, 2);
+    out.Put('.');
+    PutPadded(out, microseconds, 6);
+}
+
+// Formats a message by the default layout (see LogBase::default_format).
+// Return: size of the line, 0 if it doesn't fit into the capacity
+size_t FormatLine(char* const buffer, const size_t capacity, const TimeStamp timestamp, const LogLevel level,
+    const std::thread::id tid, const CallSite* const site, const char* const args, const size_t args_size) noexcept
+{
+    LineWriter out(buffer, capacity);
+    PutTimestamp(out, timestamp);
+
+    unsigned long long thread = 0;
+    std::memcpy(&thread, &tid, std::min(sizeof(thread), sizeof(tid)));
+    out.Put(" [");
+    PutChars(out, false, thread);
+    out.Put("] ");
+    out.Put(PrettyLevel(level));
+    out.Put(' ');
+
+    if (site)
+    {
+        PutFormatted(out, site->Format, args, args + args_size);
+    }
+    else
+    {
+        ArgFormat format;
+        const char* cursor = args;
+        const char* const end = args + args_size;
+        while (cursor < end && PutArg(out, cursor, end, format))
+        {}
+    }
+    out.Put('\n');
+
+    return out.Cut() ? 0 : out.Size();
+}
+
+} // namespace
+
+std::array<std::atomic<CrashHandler::Output*>, CrashHandler::max_outputs> CrashHandler::s_Outputs{};
+std::vector<CrashHandler::PendingOutput> CrashHandler::s_Pending;
+
+void CrashHandler::Install(const std::initializer_list<int> signals)
+{
+    std::lock_guard lock(s_Mutex);
+
+    const auto now = std::time(nullptr);
+    std::tm local{};
+    ::localtime_r(&now, &local);
+    s_UtcOffset.store(local.tm_gmtoff, std::memory_order_relaxed);
+
+    for (const int signal : signals)
+    {
+        if (signal <= 0 || signal >= NSIG)
+        {
+            throw std::invalid_argument(std::format("Signal {} can't be handled!", signal));
+        }
+        if (s_Installed[signal])
+        {
+            continue;
+        }
+
+        struct sigaction action{};
+        action.sa_handler = &CrashHandler::OnSignal;
+        sigemptyset(&action.sa_mask);
+        // alternate stack is used if the application has set one, stack overflows crash on it
+        action.sa_flags = SA_ONSTACK;
+        if (::sigaction(signal, &action, &s_Previous[signal]) != 0)
+        {
+            throw std::runtime_error(std::format("Failed to install crash handler of signal {}: {}", signal, std::strerror(errno)));
+        }
+        s_Installed[signal] = true;
+        s_Active = true;
+    }
+
+    if (s_Active)
+    {
+        for (auto&& pending : std::exchange(s_Pending, {}))
+        {
+            auto sink = pending.Sink.lock();
+            auto queue = pending.Queue.lock();
+            if (sink && queue)
+            {
+                Activate({std::move(queue), std::move(sink), pending.Encoder.lock(), pending.Recorder.lock()});
+            }
+        }
+    }
+}
+
+bool CrashHandler::AddOutput(LogQueueSptr queue, LogSinkSptr sink, BinaryEncoderSptr encoder, FlightRecorderSptr recorder)
+{
+    std::lock_guard lock(s_Mutex);
+    if (! s_Active)
+    {
+        // outputs of destroyed logs are forgotten
+        std::erase_if(s_Pending, [](const PendingOutput& output){ return output.Sink.expired(); });
+        s_Pending.push_back({queue, sink, encoder, recorder});
+        return true;
+    }
+    return Activate({std::move(queue), std::move(sink), std::move(encoder), std::move(recorder)});
+}
+
+void CrashHandler::RemoveOutput(const LogSink* const sink)
+{
+    std::lock_guard lock(s_Mutex);
+    std::erase_if(s_Pending, [sink](const PendingOutput& output){
+        return output.Sink.expired() || output.Sink.lock().get() == sink;
+    });
+    for (auto&& slot : s_Outputs)
+    {
+        if (const auto* const output = slot.load(); output && output->Sink.get() == sink)
+        {
+            Deactivate(slot);
+        }
+    }
+}
+
+void CrashHandler::RemoveOutputs()
+{
+    std::lock_guard lock(s_Mutex);
+    s_Pending.clear();
+    for (auto&& slot : s_Outputs)
+    {
+        Deactivate(slot);
+    }
+}
+
+bool CrashHandler::Activate(Output output)
+{
+    for (auto&& slot : s_Outputs)
+    {
+        if (! slot.load())
+        {
+            slot.store(new Output(std::move(output)));
+            return true;
+        }
+    }
+
+    if (! s_CapReported)
+    {
+        s_CapReported = true;
+        std::cerr << std::format("obps-log: crash handler drains at most {} outputs, outputs added over them are not drained\n", 
+            max_outputs);
+    }
+    return false;
+}
+
+void CrashHandler::Deactivate(std::atomic<Output*>& slot)
+{
+    const auto* const output = slot.exchange(nullptr);
+    // handler marks itself before it loads an output (both seq_cst), so a handler that may still
+    //  read the removed output is seen here; it is leaked then, the process is ending anyway
+    if (s_DrainingThread.load() == 0)
+    {
+        delete output;
+    }
+}
+
+void CrashHandler::OnSignal(const int signal)
+{
+    const int saved_errno = errno;
+    const auto tid = static_cast<pid_t>(::syscall(SYS_gettid));
+
+    pid_t draining = 0;
+    if (s_DrainingThread.compare_exchange_strong(draining, tid))
+    {
+        const auto deadline = Clock::now() + drain_timeout;
+        for (auto&& slot : s_Outputs)
+        {
+            if (const auto* const output = slot.load())
+            {
+                DrainOutput(*output, deadline);
+            }
+        }
+    }
+    else if (draining != tid)
+    {
+        // another thread is draining the outputs, the process ends once it has done
+        while (true)
+        {
+            ::pause();
+        }
+    }
+    // the thread that crashes while draining skips it
+
+    ::sigaction(signal, &s_Previous[signal], nullptr);
+    errno = saved_errno;
+    ::raise(signal);
+}
+
+void CrashHandler::DrainOutput(const Output& output, const Clock::time_point deadline) noexcept
+{
+    // sink belongs to the logger thread until it finishes its batch
+    if (! output.Queue->Freeze(deadline))
+    {
+        return;
+    }
+
+    // data buffered by the sink goes first, sinks that can't be written safely are left
+    if (! output.Sink->EmergencyWrite(s_Buffer, 0))
+    {
+        return;
+    }
+
+    size_t used = 0;
+    const auto drain = [&output, &used](const char* const record, const size_t size){
+        const auto message = MessageData::FromRecord(record);
+        if (message.Barrier)
+        {
+            return;
+        }
+
+        const auto args = record + sizeof(MessageData);
+        const auto args_size = size - sizeof(MessageData);
+        const auto encode = [&] {
+            return output.Encoder
+                ? output.Encoder->EncodeMessage(s_Buffer + used, crash_buffer_size - used,
+                    message.Time, message.Level, message.Tid, message.Site, args, args_size)
+                : FormatLine(s_Buffer + used, crash_buffer_size - used,
+                    message.Time, message.Level, message.Tid, message.Site, args, args_size);
+        };
+
+        auto encoded = encode();
+        if (encoded == 0 && used > 0)
+        {
+            output.Sink->EmergencyWrite(s_Buffer, used);
+            used = 0;
+            encoded = encode();
+        }
+        used += encoded;
+    };
+
+    // recorder is used by the logger thread within its batches only, recorded messages precede queued ones
+    if (output.Recorder)
+    {
+        output.Recorder->DumpTo(drain);
+    }
+    output.Queue->ReadFrozenTo(drain, deadline);
+
+    output.Sink->EmergencyWrite(s_Buffer, used);
+}
+
+} // namespace obps
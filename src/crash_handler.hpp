@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array> // std::array
+#include <atomic> // std::atomic
+#include <chrono> // std::chrono::milliseconds
+#include <cstddef> // size_t
+#include <initializer_list> // std::initializer_list
+#include <memory> // std::weak_ptr
+#include <vector> // std::vector
+
+#include "log_def.hpp"
+#include "log_sink.hpp"
+#include "binary_format.hpp"
+#include "flight_recorder.hpp"
+
+namespace obps
+{
+
+// Drains outputs into their log files when the process gets a fatal signal (Linux only).
+// Handler takes each output over between its batches (see LogQueue::Freeze),
+//  writes data buffered by the sink, then messages of its flight recorder and records left in the queue,
+//  using async-signal-safe calls where possible: the queue lock is only tried until drain_timeout,
+//  so draining is best effort. Afterwards the previous handler gets the signal.
+// Text records are formatted by the default layout, binary ones are encoded as usual.
+// Outputs to std::ostream targets and outputs that don't finish their batch in time are left as they are.
+class CrashHandler final
+{
+public:
+    static constexpr size_t max_outputs = 256;
+    // limit of the time spent waiting for logger threads and queue writers, for all outputs together
+    static constexpr std::chrono::milliseconds drain_timeout{200};
+
+    // Installs the handler of the signals, signals that are already handled by it are skipped.
+    // Outputs added before are drained from now on.
+    static void Install(std::initializer_list<int> signals);
+
+    // Output is drained on a crash until RemoveOutput, once the handler is installed.
+    // Until then the output is only remembered by weak references.
+    // Returns false if max_outputs outputs are drained already, so this one isn't;
+    //  the first output left out is reported on stderr.
+    static bool AddOutput(LogQueueSptr queue, LogSinkSptr sink, BinaryEncoderSptr encoder, FlightRecorderSptr recorder);
+
+    // Called by the logger of the output once it has finished, sink identifies the output.
+    // Output is leaked if a signal handler is draining it at the moment.
+    static void RemoveOutput(const LogSink* sink);
+
+    // Called on shutdown, before logger threads release their outputs.
+    // Outputs are leaked if a signal handler is draining them at the moment.
+    static void RemoveOutputs();
+
+private:
+    struct Output
+    {
+        LogQueueSptr Queue;
+        LogSinkSptr Sink;
+        BinaryEncoderSptr Encoder;
+        FlightRecorderSptr Recorder;
+    };
+
+    // output added before the handler is installed
+    struct PendingOutput
+    {
+        std::weak_ptr<LogQueue> Queue;
+        std::weak_ptr<LogSink> Sink;
+        std::weak_ptr<BinaryEncoder> Encoder;
+        std::weak_ptr<FlightRecorder> Recorder;
+    };
+
+    static void OnSignal(int signal);
+    static void DrainOutput(const Output& output, std::chrono::steady_clock::time_point deadline) noexcept;
+    // takes a free slot, called with the installation mutex held
+    static bool Activate(Output output);
+    // frees a slot, called with the installation mutex held
+    static void Deactivate(std::atomic<Output*>& slot);
+
+    static std::array<std::atomic<Output*>, max_outputs> s_Outputs;
+    static std::vector<PendingOutput> s_Pending; // guarded by the installation mutex
+};
+
+} // namespace obps
@@ -0,0 +1,41 @@
+#include "doorbell.hpp"
+
+namespace obps
+{
+
+void Doorbell::Ring()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_Armed.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Rings.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_Rung.notify_all();
+}
+
+uint64_t Doorbell::Arm() noexcept
+{
+    m_Armed.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return m_Rings.load(std::memory_order_relaxed);
+}
+
+void Doorbell::Wait(const uint64_t seen, const std::chrono::steady_clock::duration timeout)
+{
+    std::unique_lock lock(m_Mutex);
+    m_Rung.wait_for(lock, timeout, [this, seen]{
+        return m_Rings.load(std::memory_order_relaxed) != seen;
+    });
+}
+
+void Doorbell::Disarm() noexcept
+{
+    m_Armed.fetch_sub(1, std::memory_order_relaxed);
+}
+
+} // namespace obps
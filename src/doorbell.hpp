@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic> // std::atomic
+#include <chrono> // std::chrono::steady_clock
+#include <condition_variable> // std::condition_variable
+#include <cstdint> // uint64_t
+#include <mutex> // std::mutex
+
+namespace obps
+{
+
+// Wakes up consumer threads that wait for records of several queues at once (see SharedConsumer).
+// Writers ring it after each write, which costs a fence and a load unless a consumer is parked.
+//
+// Consumer: seen = Arm(); check queues; nothing to read: Wait(seen); Disarm().
+// Either the writer sees the armed doorbell, or the consumer sees the record while checking queues.
+class Doorbell
+{
+public:
+    Doorbell() = default;
+    ~Doorbell() = default;
+
+    void Ring();
+
+    uint64_t Arm() noexcept;
+    // waits until the doorbell rings after Arm() has returned seen, or the timeout passes
+    void Wait(uint64_t seen, std::chrono::steady_clock::duration timeout);
+    void Disarm() noexcept;
+
+    // Non-copyable
+    Doorbell(const Doorbell&) = delete;
+    Doorbell& operator=(const Doorbell&) = delete;
+
+    // Non-movable
+    Doorbell(Doorbell&&) = delete;
+    Doorbell& operator=(Doorbell&&) = delete;
+
+private:
+    std::atomic<uint32_t>   m_Armed = 0; // number of consumers that are going to park
+    std::atomic<uint64_t>   m_Rings = 0;
+    std::mutex              m_Mutex;
+    std::condition_variable m_Rung;
+};
+
+} // namespace obps
@@ -0,0 +1,138 @@
+#include "file_sink.hpp"
+
+#include <algorithm> // std::min
+#include <cerrno> // errno
+#include <cstring> // std::memcpy, std::memmove
+#include <format> // std::format
+#include <new> // std::align_val_t
+#include <stdexcept> // std::invalid_argument, std::runtime_error
+
+#include <fcntl.h> // open
+#include <unistd.h> // write, fdatasync, close
+
+namespace obps
+{
+
+namespace
+{
+
+size_t RoundUp(const size_t size, const size_t alignment) noexcept
+{
+    return alignment ? (size + alignment - 1) / alignment * alignment : size;
+}
+
+size_t CheckAlignment(const size_t alignment)
+{
+    if (alignment & (alignment - 1))
+    {
+        throw std::invalid_argument(std::format("File sink alignment {} is not a power of two!", alignment));
+    }
+    return alignment;
+}
+
+} // namespace
+
+void FileSink::AlignedDelete::operator()(char* const buffer) const noexcept
+{
+    ::operator delete[](buffer, std::align_val_t(Alignment));
+}
+
+FileSink::FileSink(const std::filesystem::path& path, const size_t buffer_size, const size_t alignment)
+    : m_Alignment(CheckAlignment(alignment))
+    , m_Fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644))
+    , m_BufferSize(RoundUp(std::max<size_t>(buffer_size, 1), alignment))
+    , m_Buffer(
+        static_cast<char*>(::operator new[](m_BufferSize, std::align_val_t(std::max(alignment, alignof(char))))),
+        AlignedDelete{std::max(alignment, alignof(char))})
+    , m_Used(0)
+    , m_Failed(false)
+{
+    if (m_Fd < 0)
+    {
+        throw std::runtime_error(std::format("Failed To Open LogFile! with path: {}", path.string()));
+    }
+}
+
+FileSink::~FileSink()
+{
+    Drain(true);
+    ::close(m_Fd);
+}
+
+void FileSink::Write(const char* data, size_t size)
+{
+    // large batch goes straight to the file, unless writes are kept aligned
+    if (m_Used == 0 && m_Alignment == 0 && size >= m_BufferSize)
+    {
+        WriteAll(data, size);
+        return;
+    }
+
+    while (size > 0)
+    {
+        const size_t chunk = std::min(size, m_BufferSize - m_Used);
+        std::memcpy(&m_Buffer[m_Used], data, chunk);
+        m_Used += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (m_Used == m_BufferSize)
+        {
+            Drain(false);
+        }
+    }
+}
+
+void FileSink::Flush(const bool sync)
+{
+    Drain(true);
+    if (sync && ::fdatasync(m_Fd) != 0)
+    {
+        m_Failed = true;
+    }
+}
+
+// buffer is written whatever the alignment is, WriteAll makes only write calls
+bool FileSink::EmergencyWrite(const char* const data, const size_t size) noexcept
+{
+    WriteAll(&m_Buffer[0], m_Used);
+    m_Used = 0;
+    WriteAll(data, size);
+    return ! m_Failed;
+}
+
+void FileSink::Drain(const bool all)
+{
+    const size_t amount = (all || m_Alignment == 0) ? m_Used : m_Used - m_Used % m_Alignment;
+    if (amount == 0)
+    {
+        return;
+    }
+
+    WriteAll(&m_Buffer[0], amount);
+
+    m_Used -= amount;
+    std::memmove(&m_Buffer[0], &m_Buffer[amount], m_Used);
+}
+
+void FileSink::WriteAll(const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        const auto written = ::write(m_Fd, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            m_Failed = true;
+            return;
+        }
+
+        data += written;
+        size -= written;
+    }
+}
+
+} // namespace obps
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <filesystem> // std::filesystem::path
+#include <memory> // std::unique_ptr
+
+#include "log_sink.hpp"
+
+namespace obps
+{
+
+// Writes to a file descriptor opened with O_APPEND, bypassing iostream.
+// Batches are accumulated in a buffer of a user configured size and written when it fills up,
+// on flush, or on destruction. fdatasync is called only for *_SYNC messages.
+//
+// With non-zero alignment the buffer is aligned to it and a full buffer is written
+// in multiples of the alignment (block size), keeping the rest for the next write,
+// which suits O_DIRECT and page cache friendly writes of large volumes.
+// Throws std::invalid_argument if the alignment is not a power of two.
+class FileSink final : public LogSink
+{
+public:
+    FileSink(const std::filesystem::path& path, size_t buffer_size, size_t alignment = 0);
+    ~FileSink() override;
+
+    void Write(const char* data, size_t size) override;
+    void Flush(bool sync) override;
+    bool EmergencyWrite(const char* data, size_t size) noexcept override;
+
+    bool Failed() const noexcept override
+    {
+        return m_Failed;
+    }
+
+    // Non-copyable
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    // Non-movable
+    FileSink(FileSink&&) = delete;
+    FileSink& operator=(FileSink&&) = delete;
+
+private:
+    struct AlignedDelete
+    {
+        size_t Alignment;
+        void operator()(char* buffer) const noexcept;
+    };
+
+    // writes buffered data, all: including a tail that is shorter than alignment
+    void Drain(bool all);
+    void WriteAll(const char* data, size_t size);
+
+    const size_t m_Alignment; // validated before the file is opened
+    int m_Fd;
+    const size_t m_BufferSize;
+    std::unique_ptr<char[], AlignedDelete> m_Buffer;
+    size_t m_Used;
+    bool m_Failed;
+};
+
+} // namespace obps
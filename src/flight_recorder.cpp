@@ -0,0 +1,89 @@
+#include "flight_recorder.hpp"
+
+#include <cstring> // std::memcpy
+
+namespace obps
+{
+
+FlightRecorder::FlightRecorder(const size_t capacity, const LogLevel write_level, const LogLevel dump_level)
+    : m_Capacity(Align(capacity))
+    , m_Buffer(std::make_unique<char[]>(m_Capacity))
+    , m_WriteLevel(write_level)
+    , m_DumpLevel(dump_level)
+    , m_Head(0)
+    , m_Tail(0)
+{}
+
+void FlightRecorder::Record(const char* const record, const size_t size) noexcept
+{
+    const size_t needed = Align(header_size + size);
+    if (needed > m_Capacity)
+    {
+        return;
+    }
+
+    size_t position;
+    size_t padding;
+    while (true)
+    {
+        if (m_Head == m_Tail)
+        {
+            m_Head = m_Tail = 0;
+        }
+
+        // record that doesn't fit at the end wraps to the beginning, the rest of the buffer is skipped
+        position = m_Head % m_Capacity;
+        padding = (m_Capacity - position < needed) ? m_Capacity - position : 0;
+        if (m_Capacity - (m_Head - m_Tail) >= padding + needed)
+        {
+            break;
+        }
+
+        const char* oldest;
+        size_t oldest_size;
+        Peek(oldest, oldest_size);
+        Release(oldest_size);
+    }
+
+    if (padding)
+    {
+        // records are aligned, so there is always room for a marker at the end
+        std::memcpy(&m_Buffer[position], &wrap_marker, sizeof(wrap_marker));
+        m_Head += padding;
+        position = 0;
+    }
+
+    const auto length = static_cast<uint32_t>(size);
+    std::memcpy(&m_Buffer[position], &length, sizeof(length));
+    std::memcpy(&m_Buffer[position + header_size], record, size);
+    m_Head += needed;
+}
+
+bool FlightRecorder::Peek(const char*& record, size_t& size) noexcept
+{
+    if (m_Tail == m_Head)
+    {
+        return false;
+    }
+
+    size_t position = m_Tail % m_Capacity;
+    uint32_t length;
+    std::memcpy(&length, &m_Buffer[position], sizeof(length));
+    if (length == wrap_marker)
+    {
+        m_Tail += m_Capacity - position;
+        position = 0;
+        std::memcpy(&length, &m_Buffer[position], sizeof(length));
+    }
+
+    record = &m_Buffer[position + header_size];
+    size = length;
+    return true;
+}
+
+void FlightRecorder::Release(const size_t size) noexcept
+{
+    m_Tail += Align(header_size + size);
+}
+
+} // namespace obps
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint> // uint32_t, uint64_t
+#include <memory> // std::unique_ptr, std::shared_ptr
+
+#include "ObpsLogConfig.hpp"
+#include "message_data.hpp"
+
+namespace obps
+{
+
+// Flight recorder of an output: bounded memory of the latest verbose message records,
+//  that are written only when a severe message arrives or a dump is requested.
+// Records are kept as they were queued, so they are formatted only if they are ever written.
+// Record layout: [uint32_t length][uint32_t padding][bytes], aligned to record_alignment,
+//  the oldest records are evicted to make room for new ones.
+//
+// Used by the logger thread of the output only, not thread safe.
+class FlightRecorder final
+{
+public:
+    static constexpr size_t record_alignment = 8;
+    static constexpr size_t header_size = 2 * sizeof(uint32_t);
+
+    // capacity: memory in bytes, rounded up to record_alignment
+    // write_level: messages of this level and more severe are written, less severe ones are recorded
+    // dump_level: messages of this level and more severe write the recorded ones before themselves
+    FlightRecorder(size_t capacity, LogLevel write_level, LogLevel dump_level);
+    ~FlightRecorder() = default;
+
+    bool Records(const LogLevel level) const noexcept
+    {
+        return level > m_WriteLevel;
+    }
+
+    bool Dumps(const LogLevel level) const noexcept
+    {
+        return level <= m_DumpLevel;
+    }
+
+    // copies record into the recorder, record larger than the whole recorder is evicted at once
+    void Record(const char* record, size_t size) noexcept;
+
+    // passes recorded records to the reader from the oldest one and forgets them
+    template <typename ReadFunc>
+    void DumpTo(ReadFunc&& reader);
+
+    // Non-copyable
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+private:
+    static constexpr uint32_t wrap_marker = ~uint32_t{0};
+
+    static constexpr size_t Align(const size_t size) noexcept
+    {
+        return (size + record_alignment - 1) & ~(record_alignment - 1);
+    }
+
+    bool Peek(const char*& record, size_t& size) noexcept;
+    void Release(size_t size) noexcept;
+
+    const size_t            m_Capacity;
+    std::unique_ptr<char[]> m_Buffer;
+    const LogLevel          m_WriteLevel;
+    const LogLevel          m_DumpLevel;
+
+    // monotonic positions, reset when the recorder is empty
+    uint64_t m_Head;
+    uint64_t m_Tail;
+};
+
+using FlightRecorderSptr = std::shared_ptr<FlightRecorder>;
+
+template <typename ReadFunc>
+void FlightRecorder::DumpTo(ReadFunc&& reader)
+{
+    const char* record;
+    size_t size;
+    while (Peek(record, size))
+    {
+        reader(record, size);
+        Release(size);
+    }
+}
+
+} // namespace obps
@@ -0,0 +1,55 @@
+#include "flush_barrier.hpp"
+
+#include <cstring> // std::memcpy
+#include <string> // std::string
+
+namespace obps
+{
+
+FlushBarrier::FlushBarrier(const size_t passes, const bool sync, const bool dump)
+    : m_Pending(passes)
+    , m_Sync(sync)
+    , m_Dump(dump)
+{}
+
+std::future<void> FlushBarrier::Queue(const std::vector<LogQueueSptr>& queues, const TimeStamp timestamp, const bool sync, const bool dump)
+{
+    // the caller holds one more pass, so the barrier isn't completed while it is being queued
+    auto* const barrier = new FlushBarrier(queues.size() + 1, sync, dump);
+    auto done = barrier->m_Done.get_future();
+
+    // record layout: [MessageData][FlushBarrier*]
+    const auto message = MessageData::FlushBarrier(timestamp);
+    std::string record(reinterpret_cast<const char*>(&message), sizeof(MessageData));
+    record.append(reinterpret_cast<const char*>(&barrier), sizeof(barrier));
+
+    for (auto&& queue : queues)
+    {
+        const auto status = queue->WriteControl(record.data(), record.size(), timestamp.time_since_epoch().count());
+        if (status != LogQueue::OperationStatus::SUCCESS)
+        {
+            barrier->Pass();
+        }
+    }
+
+    barrier->Pass();
+    return done;
+}
+
+FlushBarrier* FlushBarrier::FromArgs(const char* const args) noexcept
+{
+    FlushBarrier* barrier;
+    std::memcpy(&barrier, args, sizeof(barrier));
+    return barrier;
+}
+
+void FlushBarrier::Pass() noexcept
+{
+    if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        m_Done.set_value();
+        delete this;
+    }
+}
+
+} // namespace obps
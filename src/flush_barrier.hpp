@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic> // std::atomic
+#include <future> // std::future, std::promise
+#include <vector> // std::vector
+
+#include "log_def.hpp"
+
+namespace obps
+{
+
+// Flush request that passes through the queues of outputs in line with their messages.
+// Logger thread that reads it has got every message queued before it,
+//  so it writes and flushes them and then passes the barrier.
+// Future of the barrier is ready once all of its outputs have passed it.
+class FlushBarrier final
+{
+public:
+    // Queues a barrier record into each of the queues, a queue is listed once per output that reads it.
+    // Records are never dropped, writes wait for room whatever the overflow policy is.
+    // Queues that have been shut down are passed at once.
+    // sync: flushed data is expected to reach the storage, as with *_SYNC messages
+    // dump: outputs write messages of their flight recorders before the flush
+    static std::future<void> Queue(const std::vector<LogQueueSptr>& queues, TimeStamp timestamp, bool sync, bool dump = false);
+
+    // barrier of a record read from a queue, args point past the MessageData of the record
+    static FlushBarrier* FromArgs(const char* args) noexcept;
+
+    bool IsSync() const noexcept
+    {
+        return m_Sync;
+    }
+
+    bool IsDump() const noexcept
+    {
+        return m_Dump;
+    }
+
+    // called by an output that has flushed the messages queued before the barrier,
+    //  the last pass completes the future and destroys the barrier
+    void Pass() noexcept;
+
+    // Non-copyable
+    FlushBarrier(const FlushBarrier&) = delete;
+    FlushBarrier& operator=(const FlushBarrier&) = delete;
+
+private:
+    FlushBarrier(size_t passes, bool sync, bool dump);
+    ~FlushBarrier() = default;
+
+    std::atomic<size_t> m_Pending;
+    std::promise<void> m_Done;
+    const bool m_Sync;
+    const bool m_Dump;
+};
+
+} // namespace obps
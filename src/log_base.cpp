@@ -3,21 +3,23 @@
 namespace obps
 {
 
-void LogBase::default_format(std::ostream& out, const std::time_t ts, const LogLevel level, const std::thread::id tid, const char* text)
+void LogBase::default_format(std::ostream& out, const TimeStamp ts, const LogLevel level, const std::thread::id tid, const char* text)
 {
-    out << get_time_string("%F %T ", ts) << "[" 
+    thread_local TimestampCache time_cache;
+    out << time_cache.Format(ts, 6) << " [" 
         << tid << "] "
         << PrettyLevel(level) << " "
         << text << "\n";
 };
 
-void LogBase::JSON(std::ostream& out, const std::time_t ts, const LogLevel level, const std::thread::id tid, const char* text)
+void LogBase::JSON(std::ostream& out, const TimeStamp ts, const LogLevel level, const std::thread::id tid, const char* text)
 {
+    thread_local TimestampCache time_cache;
     out << "{\n" << std::left
         << "  "  << std::setw(10) << std::quoted("level") 
         << " : " << std::quoted(PrettyLevel(level)) << ",\n"
         << "  "  << std::setw(10) << std::quoted("date")
-        << " : " << std::quoted(get_time_string("%F %T", ts)) << ",\n"
+        << " : " << std::quoted(time_cache.Format(ts, 9)) << ",\n"
         << "  "  << std::setw(10) << std::quoted("tid")
         << " : " << tid << ",\n"
         << "  "  << std::setw(10) << std::quoted("message") 
@@ -25,14 +27,22 @@ void LogBase::JSON(std::ostream& out, const std::time_t ts, const LogLevel level
         << "\n},\n";
 };
 
-std::unique_ptr<std::ostream> LogBase::OpenFileStream(fs::path log_path)
+void LogBase::BINARY(std::ostream& out, const TimeStamp ts, const LogLevel level, const std::thread::id tid, const char* text)
 {
-    auto&& log_name = log_path.filename();
-    log_path.replace_filename(make_log_filename(log_name.string()));
-    auto file = std::make_unique<std::ofstream>(log_path, std::ios::app);
+    default_format(out, ts, level, tid, text);
+}
+
+std::unique_ptr<std::ostream> LogBase::OpenFileStream(fs::path log_path, const std::ios::openmode mode)
+{
+    return OpenLogFile(make_log_path(log_path), mode);
+}
+
+std::unique_ptr<std::ostream> LogBase::OpenLogFile(const fs::path& file_path, const std::ios::openmode mode)
+{
+    auto file = std::make_unique<std::ofstream>(file_path, mode);
     if (file->fail())
     {
-        throw std::runtime_error(std::format("Failed To Open LogFile! with path: {}", log_path.string()));
+        throw std::runtime_error(std::format("Failed To Open LogFile! with path: {}", file_path.string()));
     }
     return std::move(file);
 }
@@ -42,6 +52,14 @@ std::string make_log_filename(const std::string& prefix_name)
     return prefix_name + "-" + get_time_string("%F", get_timestamp()) + ".log";
 }
 
+// replaces filename of a path with a dated log name: <dir>/<prefix>-<date>.log
+fs::path make_log_path(fs::path log_path)
+{
+    auto&& log_name = log_path.filename();
+    log_path.replace_filename(make_log_filename(log_name.string()));
+    return log_path;
+}
+
 std::string get_time_string(const char* fmt, const std::time_t stamp) noexcept
 {
     tm date_info;
@@ -54,6 +72,59 @@ std::string get_time_string(const char* fmt, const std::time_t stamp) noexcept
     return timestr_buffer;
 }
 
+std::string_view TimestampCache::Format(const std::time_t stamp) noexcept
+{
+    if (stamp != m_Stamp)
+    {
+        const auto second = stamp - m_MinuteStart;
+        if (m_Stamp != -1 && second >= 0 && second < 60)
+        {
+            // seconds are the last two digits
+            m_Buffer[m_Size - 2] = static_cast<char>('0' + second / 10);
+            m_Buffer[m_Size - 1] = static_cast<char>('0' + second % 10);
+        }
+        else
+        {
+            tm date_info;
+            __localtime(&date_info, &stamp);
+            m_Size = strftime(m_Buffer, sizeof(m_Buffer), "%F %T", &date_info);
+            // leap second keeps the whole minute uncached
+            m_MinuteStart = date_info.tm_sec < 60 ? stamp - date_info.tm_sec : stamp - 60;
+        }
+        m_Stamp = stamp;
+    }
+    return {m_Buffer, m_Size};
+}
+
+std::string_view TimestampCache::Format(const TimeStamp stamp, size_t fraction_digits) noexcept
+{
+    const auto seconds = std::chrono::floor<std::chrono::seconds>(stamp);
+    auto fraction = (stamp - seconds).count();
+
+    const auto date_time = Format(std::chrono::system_clock::to_time_t(seconds));
+
+    fraction_digits = std::min<size_t>(fraction_digits, 9);
+    if (fraction_digits == 0)
+    {
+        return date_time;
+    }
+
+    for (auto digits = fraction_digits; digits < 9; digits++)
+    {
+        fraction /= 10;
+    }
+
+    char* const point = m_Buffer + m_Size;
+    *point = '.';
+    for (auto digit = fraction_digits; digit > 0; digit--)
+    {
+        point[digit] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+
+    return {m_Buffer, m_Size + 1 + fraction_digits};
+}
+
 const std::time_t get_timestamp() noexcept
 {
     const auto date = std::chrono::system_clock::now();
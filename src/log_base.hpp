@@ -2,13 +2,17 @@
 
 
 
+#include <algorithm> // std::max
+#include <chrono> // std::chrono::microseconds
 #include <variant> // std::variant
 #include <filesystem> // std::filesystem::path
 #include <vector> // std::vector
+#include <string_view> // std::string_view
 #include <ostream> // std::ostream
 
 #include "log_def.hpp"
 #include "log_registry.hpp"
+#include "rotating_sink.hpp"
 
 #if defined(WIN32)
 #    define __localtime(x, y) localtime_s( x, y )
@@ -40,11 +44,17 @@ protected:
     ~LogBase() = default;
 
 public:
-    static std::unique_ptr<std::ostream> OpenFileStream(fs::path log_path);
+    static std::unique_ptr<std::ostream> OpenFileStream(fs::path log_path, std::ios::openmode mode = std::ios::app);
+    // opens a file by its exact path, without a dated name
+    static std::unique_ptr<std::ostream> OpenLogFile(const fs::path& file_path, std::ios::openmode mode = std::ios::app);
 
     static MessageData::FormatFunction default_format;
     static MessageData::FormatFunction JSON;
 
+    // Marks output that writes binary message records instead of text (see binary_format.hpp),
+    //  called as an ordinary format function it falls back to default_format.
+    static MessageData::FormatFunction BINARY;
+
     LogBase(const LogBase&) = delete;
     LogBase& operator=(const LogBase&) = delete;
     LogBase(LogBase&&) = delete;
@@ -84,14 +94,83 @@ public:
             std::variant<fs::path, std::ostream*> m_Value;
         }; // struct PathOrStream
 
+        // How many messages logger thread formats into a single write of the output
+        struct BatchSpecs
+        {
+            size_t MaxRecords = LogRegistry::default_batch_size;
+            std::chrono::microseconds MaxLatency = std::chrono::microseconds::zero(); // waiting for more messages
+        };
+
+        // How an output writes to a path target
+        struct FileSpecs
+        {
+            enum class Sink 
+            {
+                STREAM, // std::ofstream
+                FD,     // FileSink: raw file descriptor with own buffer
+                MMAP,   // MmapSink: file mapped to memory by chunks
+                URING   // UringSink: asynchronous writes with io_uring, FD sink where it isn't available
+            };
+
+            Sink SinkType = Sink::STREAM;
+            size_t BufferSize = LogRegistry::default_file_buffer_size;
+            size_t Alignment = 0; // FD: aligns buffer and writes to a block size, 0 disables
+            size_t ChunkSize = LogRegistry::default_map_chunk_size; // MMAP: file grows and is mapped by chunks of this size
+            size_t Buffers = LogRegistry::default_uring_buffers; // URING: buffers of BufferSize, at most as many writes in flight
+        };
+
+        // When a path target moves to a new file, files are named <prefix>-<date>[-<hour>][.<n>].log
+        struct RotationSpecs
+        {
+            size_t MaxSize = 0;                         // bytes per file, 0 - unlimited
+            RotationPeriod Period = RotationPeriod::NONE; // HOURLY, DAILY: new file for each hour or day
+            size_t KeepFiles = 0;                       // older files are removed, 0 - keeps all
+        };
+
+        // What writes do when the output's queue is full
+        struct OverflowSpecs
+        {
+            enum class Policy
+            {
+                BLOCK,              // writer waits for the logger thread
+                DROP_NEWEST,        // message being written is dropped
+                DROP_OLDEST,        // oldest queued messages are dropped
+                DROP_BELOW_LEVEL,   // messages of KeepLevel and more severe block, others are dropped
+                SPILL               // messages go to an overflow buffer of SpillSize messages, dropped when it is full
+            };
+
+            Policy OnFull = Policy::BLOCK;
+            LogLevel KeepLevel = LogLevel{}; // DROP_BELOW_LEVEL
+            size_t SpillSize = LogRegistry::default_queue_size; // SPILL
+        };
+
+        // Flight recorder: messages less severe than WriteLevel are kept in memory of Size bytes instead of being written,
+        //  the latest ones are written before a message of DumpLevel or more severe and by Log::Dump.
+        // Output's level selects the least severe level that is recorded.
+        struct RecorderSpecs
+        {
+            size_t Size = 0;                    // 0 - recorder is off
+            LogLevel WriteLevel = LogLevel{};
+            LogLevel DumpLevel = LogLevel{};
+        };
+
         struct OutputSpecs
         {
             LogLevel Level;                     
             PathOrStream Target;    
   
             OutputModifier Mod;
-            LogQueueSptr Queue;               
+            size_t QueueSize;
+            std::string QueueId;
+            LogQueue::Mode QueueMode;
             FormatFunctionPtr Format;
+            BatchSpecs Batch;
+            FileSpecs File;
+            RotationSpecs Rotation;
+            OverflowSpecs Overflow;
+            RecorderSpecs Recorder;
+            LogQueue::WaitStrategy Wait;
+            bool UseSharedConsumer;
 
             OutputSpecs(LogLevel lvl, 
                 PathOrStream path_or_stream, 
@@ -103,15 +182,101 @@ public:
               : Level(lvl)
               , Target(path_or_stream)
               , Mod(m)
-              , Queue(LogRegistry::GetLogRegistry()->CreateAndGetQueue(queue_id, queue_size))
+              , QueueSize(queue_size)
+              , QueueId(queue_id)
+              , QueueMode(LogQueue::Mode::SHARED)
               , Format(fmt)
+              , Wait(LogQueue::WaitStrategy::SPIN_THEN_PARK)
+              , UseSharedConsumer(false)
               {}
+
+            // LogQueue::Mode::PER_THREAD gives each writer thread its own queue of queue_size,
+            //  removing contention between writers
+            OutputSpecs& SetQueueMode(LogQueue::Mode mode) noexcept
+            {
+                QueueMode = mode;
+                return *this;
+            }
+
+            // logger thread drains up to max_records messages per write, 
+            //  waiting up to max_latency after the first one for the rest
+            OutputSpecs& SetBatching(size_t max_records, std::chrono::microseconds max_latency = {}) noexcept
+            {
+                Batch = {std::max<size_t>(max_records, 1), max_latency};
+                return *this;
+            }
+
+            // selects how path target is written, ignored for stream targets
+            OutputSpecs& SetFileSpecs(const FileSpecs& file_specs) noexcept
+            {
+                File = file_specs;
+                return *this;
+            }
+
+            // selects how the logger thread waits for messages of the queue,
+            //  BUSY_SPIN occupies a whole core of the log pool
+            OutputSpecs& SetWaitStrategy(LogQueue::WaitStrategy wait) noexcept
+            {
+                Wait = wait;
+                return *this;
+            }
+
+            // output is served by the threads of LogRegistry's shared consumer 
+            //  instead of its own logger thread, wait strategy doesn't apply then
+            OutputSpecs& SetSharedConsumer(bool shared = true) noexcept
+            {
+                UseSharedConsumer = shared;
+                return *this;
+            }
+
+            // path targets only, rotation happens in the logger thread
+            OutputSpecs& SetRotation(const RotationSpecs& rotation) noexcept
+            {
+                Rotation = rotation;
+                return *this;
+            }
+
+            // selects what happens to messages when the queue is full, 
+            //  dropped messages are counted and reported by the output periodically
+            OutputSpecs& SetOverflow(const OverflowSpecs& overflow) noexcept
+            {
+                Overflow = overflow;
+                return *this;
+            }
+
+            // keeps verbose messages in memory until a severe one arrives, 
+            //  Size of default_recorder_size is used if none is given
+            OutputSpecs& SetRecorder(const RecorderSpecs& recorder) noexcept
+            {
+                Recorder = recorder;
+                if (Recorder.Size == 0)
+                {
+                    Recorder.Size = LogRegistry::default_recorder_size;
+                }
+                return *this;
+            }
         };
 
-        LogSpecs(std::initializer_list<OutputSpecs> outputs, LogPoolSptr pool = LogRegistry::GetDefaultThreadPoolInstance())
-          : m_OutputSpecs(outputs),  m_LogPool(pool)
+        LogSpecs(std::initializer_list<OutputSpecs> outputs, 
+            LogPoolSptr pool = LogRegistry::GetDefaultThreadPoolInstance(),
+            ClockSource clock = ClockSource::SYSTEM
+            )
+          : m_OutputSpecs(outputs),  m_LogPool(pool), m_Clock(clock)
         {}
 
+        // placement and scheduling of the logger threads of the outputs, 
+        //  outputs of the shared consumer use LogRegistry::SetSharedConsumerThreadSpecs
+        LogSpecs& SetThreadSpecs(const ThreadSpecs& thread_specs)
+        {
+            m_ThreadSpecs = std::make_shared<const ThreadSpecs>(thread_specs);
+            return *this;
+        }
+
+        const ThreadSpecsSptr& GetThreadSpecs() const noexcept
+        {
+            return m_ThreadSpecs;
+        }
+
         std::vector<OutputSpecs>& GetOutputSpecs() noexcept
         {
             return m_OutputSpecs;
@@ -122,16 +287,42 @@ public:
             return m_LogPool;
         }
 
+        ClockSource GetClockSource() const noexcept
+        {
+            return m_Clock;
+        }
+
     private:
         std::vector<OutputSpecs> m_OutputSpecs;
         LogPoolSptr              m_LogPool;
+        ClockSource              m_Clock;
+        ThreadSpecsSptr          m_ThreadSpecs;
     }; // class LogSpecs
 
 }; // class LogBase
 
 std::string make_log_filename(const std::string& prefix_name);
+fs::path make_log_path(fs::path log_path);
 std::string get_time_string(const char* fmt, const std::time_t stamp) noexcept;
 const std::time_t get_timestamp() noexcept;
 
+// Formats timestamps as "%F %T" in local time for a stream of close timestamps.
+// Date and time up to minutes (together with the timezone offset they imply) are cached,
+//  so localtime and strftime are called once a minute and the next second rewrites only two digits.
+class TimestampCache
+{
+public:
+    std::string_view Format(std::time_t stamp) noexcept;
+
+    // appends fraction of a second with a given number of digits: 3 - ms, 6 - us, 9 - ns
+    std::string_view Format(TimeStamp stamp, size_t fraction_digits) noexcept;
+
+private:
+    std::time_t m_MinuteStart = 0;
+    std::time_t m_Stamp = -1;
+    size_t m_Size = 0;
+    char m_Buffer[64 + 10];
+};
+
 
 } // namespace obps
\ No newline at end of file
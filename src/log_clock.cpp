@@ -0,0 +1,207 @@
+#include "log_clock.hpp"
+
+#include <algorithm> // std::max
+#include <atomic> // std::atomic, std::atomic_flag
+#include <cmath> // std::llround
+#include <cstdint> // uint64_t, int64_t
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#    include <intrin.h> // __rdtsc, __cpuid
+#    define OBPS_LOG_HAS_TSC
+#elif defined(__GNUC__) && defined(__x86_64__)
+#    include <x86intrin.h> // __rdtsc
+#    include <cpuid.h> // __get_cpuid
+#    define OBPS_LOG_HAS_TSC
+#endif
+
+namespace obps
+{
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+int64_t SystemNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+#if defined(OBPS_LOG_HAS_TSC)
+
+bool HasInvariantTsc() noexcept
+{
+    // CPUID.80000007H:EDX[8]
+#    if defined(_MSC_VER)
+    int regs[4] = {};
+    __cpuid(regs, 0x80000000);
+    if (static_cast<unsigned>(regs[0]) < 0x80000007)
+    {
+        return false;
+    }
+    __cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+#    else
+    unsigned eax, ebx, ecx, edx;
+    return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1 << 8)) != 0;
+#    endif
+}
+
+// Linear mapping of TSC ticks to the wall time.
+// The rate is measured against the system clock over the whole run time and refined every recalibration_period,
+//  the offset is slewed towards the system clock during the next period, so the time never goes back.
+// Parameters are published under a sequence lock: readers retry while a recalibration is in progress.
+class TscCalibration
+{
+public:
+    static TscCalibration& Instance() noexcept
+    {
+        static TscCalibration instance;
+        return instance;
+    }
+
+    TimeStamp Now() noexcept
+    {
+        const uint64_t tsc = __rdtsc();
+        if (tsc >= m_RecalibrateAt.load(std::memory_order_relaxed)
+            && ! m_Recalibrating.test_and_set(std::memory_order_acquire))
+        {
+            Recalibrate();
+            m_Recalibrating.clear(std::memory_order_release);
+        }
+        return TimeStamp(std::chrono::nanoseconds(Convert(tsc)));
+    }
+
+private:
+    static constexpr auto initial_calibration = 5ms;
+    static constexpr auto recalibration_period = 1s;
+
+    TscCalibration() noexcept
+        : m_OriginTsc(__rdtsc())
+        , m_OriginNs(SystemNs())
+    {
+        // rough rate to start with
+        const auto until = std::chrono::steady_clock::now() + initial_calibration;
+        while (std::chrono::steady_clock::now() < until);
+
+        const uint64_t tsc = __rdtsc();
+        const int64_t ns = SystemNs();
+        const double ns_per_tick = double(ns - m_OriginNs) / double(tsc - m_OriginTsc);
+
+        Publish(tsc, ns, ns_per_tick);
+        // short measurement is imprecise, first refinement comes early
+        m_RecalibrateAt.store(tsc + PeriodTicks(ns_per_tick) / 16, std::memory_order_relaxed);
+    }
+
+    int64_t Convert(const uint64_t tsc) const noexcept
+    {
+        uint32_t sequence;
+        uint64_t base_tsc;
+        int64_t base_ns;
+        double ns_per_tick;
+        do
+        {
+            sequence = m_Sequence.load(std::memory_order_acquire);
+            base_tsc = m_BaseTsc.load(std::memory_order_relaxed);
+            base_ns = m_BaseNs.load(std::memory_order_relaxed);
+            ns_per_tick = m_NsPerTick.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) || sequence != m_Sequence.load(std::memory_order_relaxed));
+
+        // tsc read before a concurrent recalibration is behind the base
+        return base_ns + std::llround(static_cast<int64_t>(tsc - base_tsc) * ns_per_tick);
+    }
+
+    void Recalibrate() noexcept
+    {
+        const uint64_t tsc = __rdtsc();
+        const int64_t ns = SystemNs();
+        const int64_t current = Convert(tsc);
+        const double rate = double(ns - m_OriginNs) / double(tsc - m_OriginTsc);
+
+        // behind: step forward to the wall time, ahead: slow down until the wall time catches up
+        const int64_t base_ns = std::max(ns, current);
+        const double period_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(recalibration_period).count();
+        const double slew = std::max(1.0 - (base_ns - ns) / period_ns, 0.5);
+
+        Publish(tsc, base_ns, rate * slew);
+        m_RecalibrateAt.store(tsc + PeriodTicks(rate), std::memory_order_relaxed);
+    }
+
+    void Publish(const uint64_t tsc, const int64_t ns, const double ns_per_tick) noexcept
+    {
+        const auto sequence = m_Sequence.load(std::memory_order_relaxed);
+        m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        m_BaseTsc.store(tsc, std::memory_order_relaxed);
+        m_BaseNs.store(ns, std::memory_order_relaxed);
+        m_NsPerTick.store(ns_per_tick, std::memory_order_relaxed);
+
+        m_Sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    static uint64_t PeriodTicks(const double ns_per_tick) noexcept
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(recalibration_period).count() / ns_per_tick);
+    }
+
+    const uint64_t m_OriginTsc;
+    const int64_t m_OriginNs;
+
+    std::atomic<uint32_t> m_Sequence{0};
+    std::atomic<uint64_t> m_BaseTsc{0};
+    std::atomic<int64_t> m_BaseNs{0};
+    std::atomic<double> m_NsPerTick{0.0};
+
+    std::atomic<uint64_t> m_RecalibrateAt{0};
+    std::atomic_flag m_Recalibrating = ATOMIC_FLAG_INIT;
+};
+
+#endif // OBPS_LOG_HAS_TSC
+
+// system time at the moment when steady clock has been anchored
+std::chrono::nanoseconds SteadyOffset() noexcept
+{
+    static const auto offset = std::chrono::nanoseconds(SystemNs())
+        - std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    return offset;
+}
+
+bool UseTsc() noexcept
+{
+#if defined(OBPS_LOG_HAS_TSC)
+    static const bool use_tsc = HasInvariantTsc();
+    return use_tsc;
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+void LogClock::Init(const ClockSource source) noexcept
+{
+    Now(source);
+}
+
+TimeStamp LogClock::SteadyNow() noexcept
+{
+    return TimeStamp(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()) + SteadyOffset());
+}
+
+TimeStamp LogClock::TscNow() noexcept
+{
+#if defined(OBPS_LOG_HAS_TSC)
+    if (UseTsc())
+    {
+        return TscCalibration::Instance().Now();
+    }
+#endif
+    return SteadyNow();
+}
+
+} // namespace obps
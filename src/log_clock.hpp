@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono> // std::chrono::sys_time, std::chrono::nanoseconds
+
+namespace obps
+{
+
+// Time of a message: nanoseconds since the epoch, comparable between clock sources
+using TimeStamp = std::chrono::sys_time<std::chrono::nanoseconds>;
+
+// Clock that a Log uses to stamp its messages
+enum class ClockSource
+{
+    SYSTEM, // std::chrono::system_clock: wall time, may step back on adjustments
+    STEADY, // std::chrono::steady_clock anchored to the wall time once: never goes back
+    TSC     // CPU time stamp counter calibrated to the wall time: cheapest, never goes back
+            //  falls back to STEADY on platforms without invariant TSC support
+};
+
+class LogClock
+{
+public:
+    static TimeStamp Now(const ClockSource source) noexcept
+    {
+        switch (source)
+        {
+            case ClockSource::STEADY:
+                return SteadyNow();
+            case ClockSource::TSC:
+                return TscNow();
+            default:
+                return std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now());
+        }
+    }
+
+    // prepares clock source before the first message, TSC calibration takes a few milliseconds
+    static void Init(ClockSource source) noexcept;
+
+private:
+    static TimeStamp SteadyNow() noexcept;
+    static TimeStamp TscNow() noexcept;
+};
+
+} // namespace obps
@@ -5,8 +5,8 @@
 #pragma once 
 
 #include "ObpsLogConfig.hpp"
-#include "ring_queue.hpp"
 #include "thread_pool.hpp"
+#include "log_queue.hpp"
 #include "message_data.hpp"
 
 namespace obps
@@ -30,7 +30,6 @@ using LogPool = ThreadPool<
 
 using LogPoolSptr = std::shared_ptr<LogPool>;
 
-using LogQueue = RingQueue<sizeof(MessageData)>; // queue message size depends on MessageData class size
 using LogQueueSptr = std::shared_ptr<LogQueue>;
 
 } // namespace obps
@@ -0,0 +1,36 @@
+#include "log_metrics.hpp"
+
+#include <algorithm> // std::max
+#include <cmath> // std::ceil
+
+namespace obps
+{
+
+uint64_t Histogram::Snapshot::Percentile(const double part) const noexcept
+{
+    const auto target = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(part * Count)), 1);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < buckets; bucket++)
+    {
+        seen += Counts[bucket];
+        if (seen >= target)
+        {
+            return bucket == 0 ? 0 : (uint64_t{1} << bucket) - 1;
+        }
+    }
+    return 0;
+}
+
+Histogram::Snapshot Histogram::Load() const noexcept
+{
+    Snapshot snapshot;
+    for (size_t bucket = 0; bucket < buckets; bucket++)
+    {
+        snapshot.Counts[bucket] = m_Counts[bucket].load(std::memory_order_relaxed);
+        snapshot.Count += snapshot.Counts[bucket];
+    }
+    snapshot.Sum = m_Sum.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+} // namespace obps
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm> // std::min
+#include <array> // std::array
+#include <atomic> // std::atomic
+#include <bit> // std::bit_width
+#include <cstdint> // uint64_t
+#include <string> // std::string
+
+namespace obps
+{
+
+// Counter incremented by many threads, each thread adds to its own cache line
+//  and readers sum the shards, so writers don't contend on a single atomic.
+class ShardedCounter
+{
+public:
+    static constexpr size_t shards = 16;
+    static constexpr size_t cache_line_size = 64;
+
+    void Add(const uint64_t value) noexcept
+    {
+        m_Shards[ThreadShard()].Value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t Load() const noexcept
+    {
+        uint64_t sum = 0;
+        for (const auto& shard : m_Shards)
+        {
+            sum += shard.Value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+private:
+    struct alignas(cache_line_size) Shard
+    {
+        std::atomic<uint64_t> Value = 0;
+    };
+
+    // threads get shards round-robin on their first write
+    static size_t ThreadShard() noexcept
+    {
+        static std::atomic<size_t> s_NextShard = 0;
+        thread_local const size_t t_Shard = s_NextShard.fetch_add(1, std::memory_order_relaxed) % shards;
+        return t_Shard;
+    }
+
+    std::array<Shard, shards> m_Shards;
+};
+
+// Distribution of values (sizes, durations in ns) with power of two buckets:
+//  bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i).
+// Recorded by one thread at a time, read by any thread.
+class Histogram
+{
+public:
+    static constexpr size_t buckets = 48; // the last one takes everything from 2^46
+
+    struct Snapshot
+    {
+        std::array<uint64_t, buckets> Counts{};
+        uint64_t Count = 0;
+        uint64_t Sum = 0;
+
+        // upper bound of the bucket that holds a given part (0..1) of the values
+        uint64_t Percentile(double part) const noexcept;
+
+        double Mean() const noexcept
+        {
+            return Count ? static_cast<double>(Sum) / Count : 0.0;
+        }
+    };
+
+    void Record(const uint64_t value) noexcept
+    {
+        const size_t bucket = std::min<size_t>(std::bit_width(value), buckets - 1);
+        m_Counts[bucket].fetch_add(1, std::memory_order_relaxed);
+        m_Sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    Snapshot Load() const noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, buckets> m_Counts{};
+    std::atomic<uint64_t> m_Sum = 0;
+};
+
+// Counters of a LogQueue
+struct QueueStats
+{
+    uint64_t Enqueued = 0;          // records written into the queue, spilled ones included, flush barriers not
+    uint64_t Dropped = 0;           // records dropped by writes into the full queue
+    uint64_t Depth = 0;             // records in the queue
+    uint64_t HighWaterDepth = 0;    // the deepest queue seen by the reader at the start of a batch
+    uint64_t BlockedWrites = 0;     // writes that waited for room
+    uint64_t BlockedNanos = 0;      // time writers spent waiting for room
+    Histogram::Snapshot BatchSizes; // messages per batch read by the logger thread
+};
+
+// Counters of the sink of an output, updated by its logger thread
+struct SinkMetrics
+{
+    std::atomic<uint64_t> BytesWritten = 0;
+    Histogram WriteNanos;
+    Histogram FlushNanos;
+};
+
+struct SinkStats
+{
+    uint64_t BytesWritten = 0;
+    Histogram::Snapshot WriteNanos; // duration of a batch write
+    Histogram::Snapshot FlushNanos; // duration of a flush, *_SYNC flushes reach the storage
+};
+
+struct OutputStats
+{
+    std::string QueueId;
+    QueueStats Queue;
+    SinkStats Sink;
+};
+
+} // namespace obps
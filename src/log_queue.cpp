@@ -0,0 +1,695 @@
+#include "log_queue.hpp"
+
+#include <algorithm> // std::min
+#include <cstring> // std::memcpy
+#include <stdexcept> // std::logic_error
+#include <thread> // std::this_thread::yield
+#include <unordered_map> // std::unordered_map
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <immintrin.h> // _mm_pause
+#endif
+
+namespace obps
+{
+
+namespace
+{
+
+// hints the cpu that the thread is spinning
+inline void CpuRelax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Rings of the writer thread by queue uid, owned together with the queue.
+// Ring of a finished thread is left only in the queue and dropped by the reader once it's drained.
+struct ThreadRings
+{
+    uint64_t LastUid = 0;
+    SpscRing* LastRing = nullptr;
+    std::unordered_map<uint64_t, std::shared_ptr<SpscRing>> Rings;
+};
+
+thread_local ThreadRings t_ThreadRings;
+
+uint64_t GenerateQueueUid() noexcept
+{
+    static std::atomic<uint64_t> count = {1};
+    return count.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+LogQueue::LogQueue(const size_t size, const Mode mode, const size_t spill_size)
+    : m_Mode(mode)
+    , m_Uid(GenerateQueueUid())
+    , m_Size(size)
+    , m_Capacity(Align(size * slot_size))
+    , m_Buffer(mode == Mode::SHARED ? std::make_unique<char[]>(m_Capacity) : nullptr)
+    , m_Head(0)
+    , m_Tail(0)
+    , m_Used(0)
+    , m_Reading(false)
+    , m_ShutDown(false)
+    , m_Written(0)
+    , m_WaitStrategy(WaitStrategy::SPIN_THEN_PARK)
+    , m_SpillCapacity(spill_size * slot_size)
+    , m_SpillReadPos(0)
+    , m_Spilling(false)
+    , m_ReadSpilled(false)
+    , m_Dropped(0)
+    , m_ReportedDrops(0)
+    , m_ControlRecords(0)
+    , m_Removed(0)
+    , m_HighWater(0)
+    , m_ReadRing(nullptr)
+    , m_RingsChanged(false)
+    , m_ReaderWaiting(false)
+    , m_BatchState(BatchState::IDLE)
+    , m_Doorbell(nullptr)
+{}
+
+LogQueue::OperationStatus LogQueue::Write(const char* const record, size_t size, const uint64_t order, const Overflow overflow)
+{
+    size = std::min(size, GetMaxRecordSize());
+    return m_Mode == Mode::SHARED 
+        ? WriteShared(record, size, overflow) 
+        : WritePerThread(record, size, order, overflow);
+}
+
+// While there are spilled records, writes don't go to the buffer, 
+// so the reader gets all records in the order of writes.
+LogQueue::OperationStatus LogQueue::WriteShared(const char* const record, const size_t size, const Overflow overflow)
+{
+    const size_t needed = Align(sizeof(RecordLength) + size);
+
+    size_t position;
+    bool spilled = false;
+    bool wake;
+    Clock::time_point blocked_since{};
+    {
+        std::unique_lock lock(m_Mutex);
+        while (m_ShutDown || m_Spilling || ! ReserveRoom(needed, position))
+        {
+            if (m_ShutDown)
+            {
+                return OperationStatus::SHUTDOWN;
+            }
+
+            if (overflow == Overflow::DROP_NEWEST)
+            {
+                return Drop();
+            }
+            if (overflow == Overflow::SPILL)
+            {
+                if (! Spill(record, size))
+                {
+                    return Drop();
+                }
+                spilled = true;
+                break;
+            }
+            if (overflow == Overflow::DROP_OLDEST && ! m_Spilling && DropOldest())
+            {
+                continue;
+            }
+            if (blocked_since == Clock::time_point{})
+            {
+                blocked_since = Clock::now();
+                m_BlockedWrites.Add(1); // counted at once, so a writer that is still waiting is seen
+            }
+            m_NotFull.wait(lock);
+        }
+
+        if (! spilled)
+        {
+            const auto length = static_cast<RecordLength>(size);
+            std::memcpy(&m_Buffer[position], &length, sizeof(length));
+            std::memcpy(&m_Buffer[position + sizeof(length)], record, size);
+        }
+
+        m_Written.fetch_add(1, std::memory_order_release);
+        m_Enqueued.Add(1);
+        wake = m_ReaderWaiting.load(std::memory_order_relaxed);
+    }
+
+    if (blocked_since != Clock::time_point{})
+    {
+        CountBlocked(blocked_since);
+    }
+
+    if (wake)
+    {
+        m_NotEmpty.notify_one();
+    }
+    RingDoorbell();
+    return OperationStatus::SUCCESS;
+}
+
+// Writer blocks by yielding while its ring is full, unless overflow allows to drop the record.
+// Reader is woken up only if it's waiting: the fences guarantee that either the writer sees the flag,
+// or the reader sees the record when it checks the rings after raising the flag.
+LogQueue::OperationStatus LogQueue::WritePerThread(const char* const record, const size_t size, const uint64_t order, const Overflow overflow)
+{
+    if (m_ShutDown.load(std::memory_order_relaxed))
+    {
+        return OperationStatus::SHUTDOWN;
+    }
+
+    auto& ring = GetThreadRing();
+    Clock::time_point blocked_since{};
+    while (! ring.TryWrite(record, size, order))
+    {
+        if (m_ShutDown.load(std::memory_order_relaxed))
+        {
+            return OperationStatus::SHUTDOWN;
+        }
+        if (overflow != Overflow::BLOCK)
+        {
+            return Drop();
+        }
+        if (blocked_since == Clock::time_point{})
+        {
+            blocked_since = Clock::now();
+            m_BlockedWrites.Add(1);
+        }
+        std::this_thread::yield();
+    }
+    m_Enqueued.Add(1);
+
+    if (blocked_since != Clock::time_point{})
+    {
+        CountBlocked(blocked_since);
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_ReaderWaiting.load(std::memory_order_relaxed))
+    {
+        std::lock_guard lock(m_Mutex);
+        m_NotEmpty.notify_one();
+    }
+    RingDoorbell();
+
+    return OperationStatus::SUCCESS;
+}
+
+LogQueue::OperationStatus LogQueue::WriteControl(const char* const record, const size_t size, const uint64_t order)
+{
+    const auto status = Write(record, size, order, Overflow::BLOCK);
+    if (status == OperationStatus::SUCCESS)
+    {
+        m_ControlRecords.fetch_add(1, std::memory_order_relaxed);
+    }
+    return status;
+}
+
+// blocked write itself is counted once it starts waiting
+void LogQueue::CountBlocked(const Clock::time_point since) noexcept
+{
+    m_BlockedNanos.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count());
+}
+
+QueueStats LogQueue::GetStats() const noexcept
+{
+    QueueStats stats;
+    const auto control = m_ControlRecords.load(std::memory_order_relaxed);
+    const auto enqueued = m_Enqueued.Load();
+    stats.Enqueued = enqueued > control ? enqueued - control : 0;
+    stats.Dropped = m_Dropped.load(std::memory_order_relaxed);
+    stats.Depth = GetDepth();
+    stats.HighWaterDepth = m_HighWater.load(std::memory_order_relaxed);
+    stats.BlockedWrites = m_BlockedWrites.Load();
+    stats.BlockedNanos = m_BlockedNanos.Load();
+    stats.BatchSizes = m_BatchSizes.Load();
+    return stats;
+}
+
+LogQueue::OperationStatus LogQueue::Drop() noexcept
+{
+    m_Dropped.fetch_add(1, std::memory_order_relaxed);
+    return OperationStatus::DROPPED;
+}
+
+uint64_t LogQueue::TakeDropped(const Clock::duration period)
+{
+    const auto dropped = m_Dropped.load(std::memory_order_relaxed);
+    if (dropped == m_ReportedDrops.load(std::memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    std::lock_guard read_lock(m_ReadMutex);
+    const auto now = Clock::now();
+    // first drops are reported at once, however long the host has been up
+    if (m_LastDropReport != Clock::time_point::min() && now - m_LastDropReport < period)
+    {
+        return 0;
+    }
+
+    m_LastDropReport = now;
+    return dropped - m_ReportedDrops.exchange(dropped, std::memory_order_relaxed);
+}
+
+SpscRing& LogQueue::GetThreadRing()
+{
+    auto& thread_rings = t_ThreadRings;
+    if (thread_rings.LastUid == m_Uid)
+    {
+        return *thread_rings.LastRing;
+    }
+
+    auto& ring = thread_rings.Rings[m_Uid];
+    if (! ring)
+    {
+        ring = std::make_shared<SpscRing>(m_Capacity);
+
+        std::lock_guard lock(m_Mutex);
+        m_Rings.push_back(ring);
+        m_RingsChanged.store(true, std::memory_order_release);
+    }
+
+    thread_rings.LastUid = m_Uid;
+    thread_rings.LastRing = ring.get();
+    return *ring;
+}
+
+void LogQueue::ShutDown()
+{
+    {
+        std::lock_guard lock(m_Mutex);
+        m_ShutDown = true;
+    }
+    m_NotEmpty.notify_all();
+    m_NotFull.notify_all();
+    RingDoorbell();
+}
+
+// Writers use the doorbell without the lock, so it can't be replaced
+void LogQueue::SetDoorbell(std::shared_ptr<Doorbell> doorbell)
+{
+    std::lock_guard lock(m_Mutex);
+    if (m_DoorbellOwner && m_DoorbellOwner != doorbell)
+    {
+        throw std::logic_error("Queue is already served by another consumer!");
+    }
+
+    m_DoorbellOwner = std::move(doorbell);
+    m_Doorbell.store(m_DoorbellOwner.get(), std::memory_order_release);
+}
+
+void LogQueue::RingDoorbell()
+{
+    if (auto doorbell = m_Doorbell.load(std::memory_order_acquire))
+    {
+        doorbell->Ring();
+    }
+}
+
+// Free space is [m_Head, m_Capacity) + [0, m_Tail) when the records don't wrap,
+// and [m_Head, m_Tail) otherwise. A record that doesn't fit at the end wraps to the beginning,
+// leaving the rest of the buffer as a padding that the reader skips.
+bool LogQueue::ReserveRoom(const size_t needed, size_t& position) noexcept
+{
+    if (m_Used == 0)
+    {
+        m_Head = m_Tail = 0; // whole buffer is available for a long record
+    }
+    else if (m_Head == m_Tail) // full
+    {
+        return false;
+    }
+
+    if (m_Head >= m_Tail && m_Capacity - m_Head < needed)
+    {
+        if (m_Tail < needed)
+        {
+            return false;
+        }
+
+        // records are aligned, so there is always room for a marker at the end
+        std::memcpy(&m_Buffer[m_Head], &wrap_marker, sizeof(wrap_marker));
+        m_Used += m_Capacity - m_Head;
+        m_Head = 0;
+    }
+    else if (m_Head < m_Tail && m_Tail - m_Head < needed)
+    {
+        return false;
+    }
+
+    position = m_Head;
+    m_Head = (m_Head + needed) % m_Capacity;
+    m_Used += needed;
+    return true;
+}
+
+bool LogQueue::DropOldest() noexcept
+{
+    if (m_Used == 0 || m_Reading)
+    {
+        return false;
+    }
+
+    RecordLength length;
+    std::memcpy(&length, &m_Buffer[m_Tail], sizeof(length));
+    if (length == wrap_marker)
+    {
+        m_Used -= m_Capacity - m_Tail;
+        m_Tail = 0;
+        std::memcpy(&length, &m_Buffer[m_Tail], sizeof(length));
+    }
+
+    const size_t released = Align(sizeof(RecordLength) + length);
+    m_Tail = (m_Tail + released) % m_Capacity;
+    m_Used -= released;
+    m_Dropped.fetch_add(1, std::memory_order_relaxed);
+    m_Removed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool LogQueue::Spill(const char* const record, const size_t size)
+{
+    const auto length = static_cast<RecordLength>(size);
+    if (m_Spill.size() + sizeof(length) + size > m_SpillCapacity)
+    {
+        return false;
+    }
+
+    const auto position = m_Spill.size();
+    m_Spill.resize(position + sizeof(length) + size);
+    std::memcpy(&m_Spill[position], &length, sizeof(length));
+    std::memcpy(&m_Spill[position + sizeof(length)], record, size);
+    m_Spilling = true;
+    return true;
+}
+
+// Spilled records are read from the reader's copy of the overflow buffer, 
+// writers append to the other one meanwhile.
+bool LogQueue::AcquireSpilled(const char*& record, size_t& size)
+{
+    if (m_SpillReadPos == m_SpillRead.size())
+    {
+        m_SpillRead.clear();
+        m_SpillRead.swap(m_Spill);
+        m_SpillReadPos = 0;
+        if (m_SpillRead.empty())
+        {
+            return false;
+        }
+    }
+
+    RecordLength length;
+    std::memcpy(&length, &m_SpillRead[m_SpillReadPos], sizeof(length));
+    record = &m_SpillRead[m_SpillReadPos + sizeof(length)];
+    size = length;
+    m_ReadSpilled = true;
+    return true;
+}
+
+// Only the reader's copy of the rings is iterated on the hot path, 
+// it is refreshed after a new writer registers its ring.
+bool LogQueue::PeekOldestRing(const char*& record, size_t& size)
+{
+    if (m_RingsChanged.load(std::memory_order_acquire))
+    {
+        RefreshRings();
+    }
+
+    m_ReadRing = nullptr;
+    uint64_t oldest = 0;
+    for (auto&& ring : m_ReaderRings)
+    {
+        const char* ring_record;
+        size_t ring_size;
+        uint64_t order;
+        if (ring->Peek(ring_record, ring_size, order) && (! m_ReadRing || order < oldest))
+        {
+            m_ReadRing = ring.get();
+            oldest = order;
+            record = ring_record;
+            size = ring_size;
+        }
+    }
+
+    return m_ReadRing != nullptr;
+}
+
+void LogQueue::RefreshRings()
+{
+    std::lock_guard lock(m_Mutex);
+    m_RingsChanged.store(false, std::memory_order_relaxed);
+    m_ReaderRings.clear();
+
+    // the last reference means that writer thread has finished and its thread locals are gone
+    std::erase_if(m_Rings, [](const SpscRingSptr& ring){
+        if (ring.use_count() != 1)
+        {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return ring->IsEmpty();
+    });
+
+    m_ReaderRings = m_Rings;
+}
+
+bool LogQueue::AnyRingReady() const noexcept
+{
+    return std::any_of(m_Rings.begin(), m_Rings.end(), [](const SpscRingSptr& ring){
+        return ! ring->IsEmpty();
+    });
+}
+
+template <typename Predicate>
+bool LogQueue::SpinWait(const Clock::time_point deadline, Predicate&& ready)
+{
+    const auto strategy = GetWaitStrategy();
+    if (strategy == WaitStrategy::BLOCK)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; strategy == WaitStrategy::BUSY_SPIN || i < spin_count + yield_count; i++)
+    {
+        if (ready())
+        {
+            return true;
+        }
+
+        // clock is read rarely, it costs more than a pause
+        if (m_ShutDown.load(std::memory_order_relaxed) || (i % 64 == 0 && Clock::now() >= deadline))
+        {
+            return false;
+        }
+
+        if (strategy == WaitStrategy::BUSY_SPIN || i < spin_count)
+        {
+            CpuRelax();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    return false;
+}
+
+bool LogQueue::AcquireRecord(const char*& record, size_t& size, const Clock::time_point deadline)
+{
+    if (m_Mode == Mode::PER_THREAD)
+    {
+        if (PeekOldestRing(record, size) 
+            || SpinWait(deadline, [this, &record, &size]{ return PeekOldestRing(record, size); }))
+        {
+            return true;
+        }
+
+        while (! PeekOldestRing(record, size))
+        {
+            std::unique_lock lock(m_Mutex);
+            WaitNotEmpty(lock, deadline, [this]{ return m_ShutDown || AnyRingReady(); });
+
+            if (! AnyRingReady())
+            {
+                return false; // timed out, or shut down and drained
+            }
+            m_RingsChanged.store(true, std::memory_order_relaxed); // rings could be registered while waiting
+        }
+        return true;
+    }
+
+    const auto ready = [this]{ return m_ShutDown || m_Used > 0 || m_Spilling; };
+    std::unique_lock lock(m_Mutex);
+    if (! ready() && GetWaitStrategy() != WaitStrategy::BLOCK)
+    {
+        // records can't be checked without the lock, the counter of writes is polled instead
+        const auto written = m_Written.load(std::memory_order_relaxed);
+        lock.unlock();
+        SpinWait(deadline, [this, written]{ return m_Written.load(std::memory_order_acquire) != written; });
+        lock.lock();
+    }
+    WaitNotEmpty(lock, deadline, ready);
+    if (m_Used == 0)
+    {
+        // spilled records are newer than all records of the buffer
+        return m_Spilling && AcquireSpilled(record, size); // false: timed out, or shut down and drained
+    }
+
+    RecordLength length;
+    std::memcpy(&length, &m_Buffer[m_Tail], sizeof(length));
+    if (length == wrap_marker)
+    {
+        m_Used -= m_Capacity - m_Tail;
+        m_Tail = 0;
+        std::memcpy(&length, &m_Buffer[m_Tail], sizeof(length));
+    }
+
+    record = &m_Buffer[m_Tail + sizeof(length)];
+    size = length;
+    m_Reading = true;
+    return true;
+}
+
+void LogQueue::ReleaseRecord(const size_t size)
+{
+    m_Removed.fetch_add(1, std::memory_order_relaxed);
+    if (m_Mode == Mode::PER_THREAD)
+    {
+        m_ReadRing->Release(size);
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_Mutex);
+        if (m_ReadSpilled)
+        {
+            m_ReadSpilled = false;
+            m_SpillReadPos += sizeof(RecordLength) + size;
+            m_Spilling = m_SpillReadPos < m_SpillRead.size() || ! m_Spill.empty();
+        }
+        else
+        {
+            const size_t released = Align(sizeof(RecordLength) + size);
+            m_Tail = (m_Tail + released) % m_Capacity;
+            m_Used -= released;
+            m_Reading = false;
+        }
+    }
+    m_NotFull.notify_all();
+}
+
+void LogQueue::BeginBatch() noexcept
+{
+    auto state = BatchState::IDLE;
+    while (! m_BatchState.compare_exchange_strong(state, BatchState::BATCH, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        // another output of the queue is writing its batch, or the process is about to end
+        if (state == BatchState::FROZEN)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+        state = BatchState::IDLE;
+    }
+}
+
+void LogQueue::EndBatch() noexcept
+{
+    m_BatchState.store(BatchState::IDLE, std::memory_order_release);
+}
+
+bool LogQueue::Freeze(const Clock::time_point deadline) noexcept
+{
+    auto state = BatchState::IDLE;
+    while (! m_BatchState.compare_exchange_strong(state, BatchState::FROZEN, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        if (state == BatchState::FROZEN)
+        {
+            return true;
+        }
+        if (Clock::now() >= deadline)
+        {
+            return false;
+        }
+        std::this_thread::yield();
+        state = BatchState::IDLE;
+    }
+    return true;
+}
+
+// Frozen reader may hold an acquired record that it will never release, the record is read again.
+// Reader's own state (m_ReadRing, m_ReaderRings) isn't touched, it may still be looking for records.
+bool LogQueue::AcquireFrozen(const char*& record, size_t& size, SpscRing*& ring) noexcept
+{
+    if (m_Mode == Mode::PER_THREAD)
+    {
+        ring = nullptr;
+        uint64_t oldest = 0;
+        for (auto&& candidate : m_Rings)
+        {
+            const char* ring_record;
+            size_t ring_size;
+            uint64_t order;
+            if (candidate->Peek(ring_record, ring_size, order) && (! ring || order < oldest))
+            {
+                ring = candidate.get();
+                oldest = order;
+                record = ring_record;
+                size = ring_size;
+            }
+        }
+        return ring != nullptr;
+    }
+
+    ring = nullptr;
+    if (m_Used == 0)
+    {
+        // spilled records are newer than all records of the buffer
+        return m_Spilling && AcquireSpilled(record, size);
+    }
+
+    RecordLength length;
+    std::memcpy(&length, &m_Buffer[m_Tail], sizeof(length));
+    if (length == wrap_marker)
+    {
+        m_Used -= m_Capacity - m_Tail;
+        m_Tail = 0;
+        std::memcpy(&length, &m_Buffer[m_Tail], sizeof(length));
+    }
+
+    record = &m_Buffer[m_Tail + sizeof(length)];
+    size = length;
+    m_ReadSpilled = false;
+    return true;
+}
+
+void LogQueue::ReleaseFrozen(const size_t size, SpscRing* const ring) noexcept
+{
+    m_Removed.fetch_add(1, std::memory_order_relaxed);
+    if (ring)
+    {
+        ring->Release(size);
+    }
+    else if (m_ReadSpilled)
+    {
+        m_ReadSpilled = false;
+        m_SpillReadPos += sizeof(RecordLength) + size;
+        m_Spilling = m_SpillReadPos < m_SpillRead.size() || ! m_Spill.empty();
+    }
+    else
+    {
+        const size_t released = Align(sizeof(RecordLength) + size);
+        m_Tail = (m_Tail + released) % m_Capacity;
+        m_Used -= released;
+        m_Reading = false;
+    }
+}
+
+} // namespace obps
@@ -0,0 +1,436 @@
+#pragma once
+
+#include <atomic> // std::atomic
+#include <chrono> // std::chrono::steady_clock
+#include <condition_variable> // std::condition_variable
+#include <cstdint> // uint32_t, uint64_t
+#include <memory> // std::unique_ptr, std::shared_ptr
+#include <mutex> // std::mutex
+#include <thread> // std::this_thread::yield
+#include <type_traits> // std::invoke_result_t, std::is_void_v
+#include <vector> // std::vector
+
+#include "ObpsLogConfig.hpp"
+#include "doorbell.hpp"
+#include "log_metrics.hpp"
+#include "spsc_ring.hpp"
+
+namespace obps
+{
+
+// Byte oriented ring buffer of variable length records.
+// Each record is stored contiguously as [uint32_t length][bytes], padded up to record_alignment,
+// so short messages take little memory and long ones aren't limited by a fixed slot size.
+//
+// Multiple producers, readers are serialized by the read mutex:
+//  SHARED:     writers are serialized by the mutex, the reader processes a record outside the lock,
+//              since writers never touch memory that hasn't been released by the reader.
+//  PER_THREAD: each writer thread gets its own lock-free SpscRing of the queue capacity,
+//              the reader merges rings by the order key of their oldest records (message timestamp).
+//              Writers take the mutex only to register their ring and to wake up the sleeping reader.
+//
+// What a write does when there is no room for the record is chosen per write (see Overflow),
+// how the reader waits for records is chosen per queue (see WaitStrategy).
+// Writers wake the reader up only when it is parked.
+class LogQueue
+{
+public:
+    enum class OperationStatus
+    {
+        SUCCESS,
+        SHUTDOWN,
+        DROPPED,
+        EMPTY
+    };
+
+    enum class Mode
+    {
+        SHARED,
+        PER_THREAD
+    };
+
+    // Behaviour of a write into a full queue
+    enum class Overflow
+    {
+        BLOCK,          // waits for the reader to release room
+        DROP_NEWEST,    // record being written is dropped
+        DROP_OLDEST,    // oldest records are dropped to make room, 
+                        //  waits only while the reader processes the oldest one
+        SPILL           // record goes to the overflow buffer of spill_size messages, 
+                        //  following records too until the reader drains it, dropped when it's full
+    };
+
+    // How the reader waits for the next record
+    enum class WaitStrategy
+    {
+        BLOCK,          // parks on the condition variable (futex) right away: background logs
+        SPIN_THEN_PARK, // spins, then yields for a while, then parks: general use
+        BUSY_SPIN       // never parks, occupies a core: ultra-low latency on a pinned core
+    };
+
+    using RecordLength = uint32_t;
+
+    static constexpr size_t record_alignment = 8;
+    // memory reserved per message of the queue size, messages longer than that still fit
+    //  as long as they fit into the whole queue
+    static constexpr size_t slot_size = sizeof(RecordLength) + MAX_MSG_SIZE;
+
+    // size: queue capacity in messages of MAX_MSG_SIZE (per writer thread in PER_THREAD mode)
+    // spill_size: capacity of the overflow buffer used by Overflow::SPILL writes, in messages of MAX_MSG_SIZE
+    explicit LogQueue(size_t size, Mode mode = Mode::SHARED, size_t spill_size = 0);
+    ~LogQueue() = default;
+
+    // Copies record into the queue, if there is no room for it acts according to overflow.
+    // Records longer than GetMaxRecordSize() are truncated.
+    // order: key by which records of different writers are merged in PER_THREAD mode
+    // PER_THREAD mode: rings can't be modified by the writer's side, so DROP_OLDEST and SPILL drop the newest record
+    // Returns DROPPED if the record has been dropped.
+    OperationStatus Write(const char* record, size_t size, uint64_t order = 0, Overflow overflow = Overflow::BLOCK);
+
+    // Write of a control record (a flush barrier): waits for room and isn't counted as enqueued by GetStats.
+    OperationStatus WriteControl(const char* record, size_t size, uint64_t order = 0);
+
+    // Waits for the next record and passes it to the reader: void(const char* record, size_t size).
+    // Batch readers may return bool instead, false for control records that aren't counted in batch sizes.
+    // Record memory is valid only during the call.
+    // Returns SHUTDOWN once the queue has been shut down and drained.
+    template <typename ReadFunc>
+    OperationStatus ReadTo(ReadFunc&& reader);
+
+    // Reads up to max_records records in one pass: waits for the first record, 
+    // then takes records that arrive until max_latency since the first one has passed.
+    // Zero max_latency takes only records that are already in the queue.
+    // Returns SHUTDOWN once the queue has been shut down and drained.
+    template <typename ReadFunc>
+    OperationStatus ReadBatchTo(ReadFunc&& reader, size_t max_records, std::chrono::microseconds max_latency);
+
+    // Same as ReadBatchTo, but returns EMPTY right away if there are no records.
+    template <typename ReadFunc>
+    OperationStatus TryReadBatchTo(ReadFunc&& reader, size_t max_records, std::chrono::microseconds max_latency);
+
+    // Doorbell that is rung after every write and shutdown, for readers that wait for several queues.
+    // Reader's own waiting is not affected. Throws if the queue already has another doorbell.
+    void SetDoorbell(std::shared_ptr<Doorbell> doorbell);
+
+    // wakes up all waiting threads, following writes are rejected
+    void ShutDown();
+
+    // total number of records dropped by writes into the full queue
+    uint64_t GetDroppedCount() const noexcept
+    {
+        return m_Dropped.load(std::memory_order_relaxed);
+    }
+
+    // Counters for monitoring, each of them is read with a relaxed load
+    QueueStats GetStats() const noexcept;
+
+    // Reader side: number of records dropped since the previous report,
+    //  0 if there are none or the period since the previous report hasn't passed yet
+    uint64_t TakeDropped(std::chrono::steady_clock::duration period);
+
+    // Output that reads the queue holds a batch from its first record until the batch is written to its sink.
+    // BeginBatch waits while the output is frozen by the crash handler (see CrashHandler).
+    void BeginBatch() noexcept;
+    void EndBatch() noexcept;
+
+    // Async-signal-safe: freezes the output between its batches, gives up at the deadline.
+    // Frozen output never begins another batch, so its sink may be used by the caller.
+    bool Freeze(std::chrono::steady_clock::time_point deadline) noexcept;
+
+    // Passes records left in a frozen queue to the reader without waiting for writers.
+    // Best effort, bounded by the deadline: the queue lock is taken by std::mutex::try_lock,
+    //  which isn't guaranteed to be async-signal-safe; records are left if a writer holds the lock
+    //  until the deadline (the crashing thread may be the one).
+    template <typename ReadFunc>
+    void ReadFrozenTo(ReadFunc&& reader, std::chrono::steady_clock::time_point deadline) noexcept;
+
+    size_t GetSize() const noexcept
+    {
+        return m_Size;
+    }
+
+    Mode GetMode() const noexcept
+    {
+        return m_Mode;
+    }
+
+    void SetWaitStrategy(WaitStrategy strategy) noexcept
+    {
+        m_WaitStrategy.store(strategy, std::memory_order_relaxed);
+    }
+
+    WaitStrategy GetWaitStrategy() const noexcept
+    {
+        return m_WaitStrategy.load(std::memory_order_relaxed);
+    }
+
+    size_t GetMaxRecordSize() const noexcept
+    {
+        return m_Capacity - (m_Mode == Mode::SHARED ? sizeof(RecordLength) : SpscRing::header_size);
+    }
+
+    // Non-copyable
+    LogQueue(const LogQueue&) = delete;
+    LogQueue& operator=(const LogQueue&) = delete;
+
+    // Non-movable
+    LogQueue(LogQueue&&) = delete;
+    LogQueue& operator=(LogQueue&&) = delete;
+
+private:
+    static constexpr RecordLength wrap_marker = ~RecordLength{0};
+
+    static constexpr size_t Align(const size_t size) noexcept
+    {
+        return (size + record_alignment - 1) & ~(record_alignment - 1);
+    }
+
+    using SpscRingSptr = std::shared_ptr<SpscRing>;
+
+    OperationStatus WriteShared(const char* record, size_t size, Overflow overflow);
+    OperationStatus WritePerThread(const char* record, size_t size, uint64_t order, Overflow overflow);
+    OperationStatus Drop() noexcept;
+
+    // finds position for a record of a given aligned size, returns false if there is no room
+    bool ReserveRoom(size_t needed, size_t& position) noexcept;
+    // releases the oldest record if the reader doesn't hold it, returns false otherwise
+    bool DropOldest() noexcept;
+    // appends record to the overflow buffer, returns false if there is no room
+    bool Spill(const char* record, size_t size);
+    // reads the next spilled record, returns false if there are none
+    bool AcquireSpilled(const char*& record, size_t& size);
+
+    // returns ring of the calling thread, creates and registers it on the first call
+    SpscRing& GetThreadRing();
+    // picks ring with the oldest record, returns false if all rings are empty
+    bool PeekOldestRing(const char*& record, size_t& size);
+    // updates reader's copy of the rings list, drops empty rings of finished threads
+    void RefreshRings();
+    bool AnyRingReady() const noexcept;
+
+    using Clock = std::chrono::steady_clock;
+
+    void CountBlocked(Clock::time_point since) noexcept;
+
+    // waits for the next record until the deadline, returns false on timeout or shutdown of an empty queue
+    bool AcquireRecord(const char*& record, size_t& size, Clock::time_point deadline = Clock::time_point::max());
+
+    // reader's spin phase before parking: pause instructions, then yields
+    static constexpr size_t spin_count = 1024;
+    static constexpr size_t yield_count = 64;
+
+    // spins according to the wait strategy until ready() holds, 
+    //  returns false once the spin budget or deadline is exhausted, or the queue is shut down
+    template <typename Predicate>
+    bool SpinWait(Clock::time_point deadline, Predicate&& ready);
+
+    template <typename ReadFunc>
+    OperationStatus ReadBatch(ReadFunc&& reader, size_t max_records, std::chrono::microseconds max_latency, Clock::time_point first_deadline);
+
+    void RingDoorbell();
+
+    template <typename ReadFunc>
+    static bool ReadRecord(ReadFunc& reader, const char* record, size_t size);
+
+    uint64_t GetDepth() const noexcept
+    {
+        const auto removed = m_Removed.load(std::memory_order_relaxed);
+        const auto enqueued = m_Enqueued.Load();
+        return enqueued > removed ? enqueued - removed : 0;
+    }
+
+    template <typename Predicate>
+    void WaitNotEmpty(std::unique_lock<std::mutex>& lock, Clock::time_point deadline, Predicate&& ready);
+    void ReleaseRecord(size_t size);
+
+    enum class BatchState : uint8_t
+    {
+        IDLE,
+        BATCH,  // output holds records that haven't been written yet
+        FROZEN  // crash handler has taken the output over
+    };
+
+    // reads records of a frozen queue, called with m_Mutex held; ring: ring of a PER_THREAD record
+    bool AcquireFrozen(const char*& record, size_t& size, SpscRing*& ring) noexcept;
+    void ReleaseFrozen(size_t size, SpscRing* ring) noexcept;
+
+    const Mode              m_Mode;
+    const uint64_t          m_Uid; // distinguishes queues in writer's thread local ring cache
+    const size_t            m_Size;
+    const size_t            m_Capacity; // in bytes
+    std::unique_ptr<char[]> m_Buffer;
+
+    size_t m_Head; // write position
+    size_t m_Tail; // read position
+    size_t m_Used; // bytes used by records and wrap padding
+    bool   m_Reading; // reader holds the record at m_Tail
+    std::atomic<bool> m_ShutDown;
+    std::atomic<uint64_t> m_Written; // records written in SHARED mode, polled by the spinning reader
+    std::atomic<WaitStrategy> m_WaitStrategy;
+
+    // Overflow::SPILL, records are [RecordLength][bytes]
+    const size_t      m_SpillCapacity; // in bytes
+    std::vector<char> m_Spill;          // written under m_Mutex
+    std::vector<char> m_SpillRead;      // taken by the reader from m_Spill once the buffer is drained
+    size_t            m_SpillReadPos;
+    bool              m_Spilling;       // there are unread spilled records, writers append to them to keep order
+    bool              m_ReadSpilled;    // acquired record is a spilled one
+
+    std::atomic<uint64_t> m_Dropped;
+    std::atomic<uint64_t> m_ReportedDrops;
+    Clock::time_point     m_LastDropReport = Clock::time_point::min(); // min: never reported, guarded by m_ReadMutex
+
+    // metrics, writers count into shards of their threads
+    ShardedCounter        m_Enqueued;   // control records included, they are needed by GetDepth
+    std::atomic<uint64_t> m_ControlRecords;
+    ShardedCounter        m_BlockedWrites;
+    ShardedCounter        m_BlockedNanos;
+    std::atomic<uint64_t> m_Removed;    // records read or dropped from the queue
+    std::atomic<uint64_t> m_HighWater;  // updated by the reader
+    Histogram             m_BatchSizes;
+
+    // PER_THREAD mode
+    std::vector<SpscRingSptr> m_Rings;          // guarded by m_Mutex
+    std::vector<SpscRingSptr> m_ReaderRings;    // reader's copy
+    SpscRing*                 m_ReadRing;       // ring of the acquired record
+    std::atomic<bool>         m_RingsChanged;
+
+    std::atomic<bool>       m_ReaderWaiting; // reader is parked, set under m_Mutex
+    std::atomic<BatchState> m_BatchState;
+    std::shared_ptr<Doorbell> m_DoorbellOwner;  // guarded by m_Mutex
+    std::atomic<Doorbell*>    m_Doorbell;
+    std::mutex              m_Mutex;
+    std::mutex              m_ReadMutex; // queue may be shared by several outputs
+    std::condition_variable m_NotEmpty;
+    std::condition_variable m_NotFull;
+};
+
+template <typename ReadFunc>
+LogQueue::OperationStatus LogQueue::ReadTo(ReadFunc&& reader)
+{
+    std::lock_guard read_lock(m_ReadMutex);
+
+    const char* record;
+    size_t size;
+    if (! AcquireRecord(record, size))
+    {
+        return OperationStatus::SHUTDOWN;
+    }
+
+    reader(record, size);
+
+    ReleaseRecord(size);
+    return OperationStatus::SUCCESS;
+}
+
+template <typename ReadFunc>
+LogQueue::OperationStatus LogQueue::ReadBatchTo(ReadFunc&& reader, const size_t max_records, const std::chrono::microseconds max_latency)
+{
+    return ReadBatch(reader, max_records, max_latency, Clock::time_point::max());
+}
+
+template <typename ReadFunc>
+LogQueue::OperationStatus LogQueue::TryReadBatchTo(ReadFunc&& reader, const size_t max_records, const std::chrono::microseconds max_latency)
+{
+    return ReadBatch(reader, max_records, max_latency, Clock::time_point::min());
+}
+
+template <typename ReadFunc>
+LogQueue::OperationStatus LogQueue::ReadBatch(ReadFunc&& reader, const size_t max_records, const std::chrono::microseconds max_latency, 
+    const Clock::time_point first_deadline)
+{
+    std::lock_guard read_lock(m_ReadMutex);
+
+    const char* record;
+    size_t size;
+    if (! AcquireRecord(record, size, first_deadline))
+    {
+        // empty queue that has been shut down is drained
+        return m_ShutDown ? OperationStatus::SHUTDOWN : OperationStatus::EMPTY;
+    }
+
+    // records that are waiting when the batch starts, the first one included
+    const auto depth = GetDepth();
+    if (depth > m_HighWater.load(std::memory_order_relaxed))
+    {
+        m_HighWater.store(depth, std::memory_order_relaxed);
+    }
+
+    const auto deadline = Clock::now() + max_latency;
+    size_t count = 0;
+    size_t messages = 0;
+    do
+    {
+        messages += ReadRecord(reader, record, size);
+        ReleaseRecord(size);
+    } 
+    while (++count < max_records && AcquireRecord(record, size, deadline));
+
+    if (messages)
+    {
+        m_BatchSizes.Record(messages);
+    }
+    return OperationStatus::SUCCESS;
+}
+
+template <typename ReadFunc>
+bool LogQueue::ReadRecord(ReadFunc& reader, const char* const record, const size_t size)
+{
+    if constexpr (std::is_void_v<std::invoke_result_t<ReadFunc&, const char*, size_t>>)
+    {
+        reader(record, size);
+        return true;
+    }
+    else
+    {
+        return reader(record, size);
+    }
+}
+
+template <typename ReadFunc>
+void LogQueue::ReadFrozenTo(ReadFunc&& reader, const Clock::time_point deadline) noexcept
+{
+    std::unique_lock lock(m_Mutex, std::defer_lock);
+    while (! lock.try_lock())
+    {
+        if (Clock::now() >= deadline)
+        {
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    const char* record;
+    size_t size;
+    SpscRing* ring;
+    while (AcquireFrozen(record, size, ring))
+    {
+        reader(record, size);
+        ReleaseFrozen(size, ring);
+    }
+}
+
+template <typename Predicate>
+void LogQueue::WaitNotEmpty(std::unique_lock<std::mutex>& lock, const Clock::time_point deadline, Predicate&& ready)
+{
+    if (ready())
+    {
+        return;
+    }
+
+    m_ReaderWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (deadline == Clock::time_point::max())
+    {
+        m_NotEmpty.wait(lock, ready);
+    }
+    else
+    {
+        m_NotEmpty.wait_until(lock, deadline, ready);
+    }
+
+    m_ReaderWaiting.store(false, std::memory_order_relaxed);
+}
+
+} // namespace obps
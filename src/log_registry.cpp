@@ -1,24 +1,49 @@
 #include "log_registry.hpp"
+#include "flush_barrier.hpp"
+
+#include <mutex> // std::call_once
+#include <stdexcept> // std::logic_error, std::runtime_error
+
+#if defined(LINUX)
+#    include <csignal> // SIGSEGV, SIGABRT, ...
+
+#    include "crash_handler.hpp"
+#endif
 
 namespace obps
 {
 
 template LogPool; // instantiate LogPool
 
-LogQueueSptr LogRegistry::CreateAndGetQueue(const std::string id, const size_t size)
+namespace
 {
-    auto&& [iter, emplaced] = m_Queues.try_emplace(id, std::make_shared<LogQueue>(size));
+
+SharedConsumerSptr s_SharedConsumer;
+ThreadSpecsSptr s_SharedConsumerThreadSpecs;
+
+} // namespace
+
+LogQueueSptr LogRegistry::CreateAndGetQueue(const std::string id, const size_t size, const LogQueue::Mode mode, const size_t spill_size)
+{
+    std::lock_guard lock(m_Mutex);
+    auto&& [iter, emplaced] = m_Queues.try_emplace(id, std::make_shared<LogQueue>(size, mode, spill_size));
     if ((!emplaced) && iter->second->GetSize() != size)
     {
         throw std::logic_error("Trying to create queue of different size with same id!");
     }
 
+    if ((!emplaced) && iter->second->GetMode() != mode)
+    {
+        throw std::logic_error("Trying to create queue of different mode with same id!");
+    }
+
     return iter->second;
 } 
 
 // Shutdown all queues politely
 void LogRegistry::WipeAllQueues()
 {
+    std::lock_guard lock(m_Mutex);
     for(auto && [_, queue] : m_Queues)
     {
         queue->ShutDown();
@@ -27,6 +52,65 @@ void LogRegistry::WipeAllQueues()
     m_Queues.clear();
 }
 
+void LogRegistry::RegisterOutput(const std::string& queue_id, const std::shared_ptr<const SinkMetrics>& metrics)
+{
+    std::lock_guard lock(m_Mutex);
+    m_Outputs.emplace_back(queue_id, metrics);
+}
+
+// Outputs of destroyed logs are forgotten, queues that have been wiped report zero counters
+std::vector<OutputStats> LogRegistry::GetOutputStats()
+{
+    std::lock_guard lock(m_Mutex);
+    std::erase_if(m_Outputs, [](const auto& output){ return output.second.expired(); });
+
+    std::vector<OutputStats> stats;
+    stats.reserve(m_Outputs.size());
+    for (const auto& [queue_id, weak_metrics] : m_Outputs)
+    {
+        auto& output = stats.emplace_back();
+        output.QueueId = queue_id;
+        if (const auto queue = m_Queues.find(queue_id); queue != m_Queues.end())
+        {
+            output.Queue = queue->second->GetStats();
+        }
+        if (const auto metrics = weak_metrics.lock())
+        {
+            output.Sink.BytesWritten = metrics->BytesWritten.load(std::memory_order_relaxed);
+            output.Sink.WriteNanos = metrics->WriteNanos.Load();
+            output.Sink.FlushNanos = metrics->FlushNanos.Load();
+        }
+    }
+    return stats;
+}
+
+void LogRegistry::Flush(const bool sync)
+{
+    FlushAsync(sync).wait();
+}
+
+std::future<void> LogRegistry::FlushAsync(const bool sync)
+{
+    std::vector<LogQueueSptr> queues;
+    {
+        std::lock_guard lock(m_Mutex);
+        std::erase_if(m_Outputs, [](const auto& output){ return output.second.expired(); });
+        queues.reserve(m_Outputs.size());
+        for (const auto& [queue_id, _] : m_Outputs)
+        {
+            if (const auto queue = m_Queues.find(queue_id); queue != m_Queues.end())
+            {
+                queues.push_back(queue->second);
+            }
+        }
+    }
+
+    // barriers are queued without the lock, writes into full queues wait for the logger threads.
+    // Clocks of all sources are anchored to the wall time, so the barrier is merged
+    //  after the earlier messages of PER_THREAD queues whatever clock their log uses.
+    return FlushBarrier::Queue(queues, LogClock::Now(ClockSource::SYSTEM), sync);
+}
+
 // Generates queue id consisting of prefix "q_" and hex incrementor.
 // NOTE{Jekas}: thoughts about making it to use thread id of a log writer thread for the uniqueness, or some uid library
 //  for now atomic counter for thread safeness is enough.
@@ -37,12 +121,28 @@ std::string LogRegistry::GenerateQueueUid()
     return std::format("q_{:#}", count.fetch_add(1, std::memory_order_relaxed));
 }
 
+void LogRegistry::InstallCrashHandler()
+{
+#if defined(LINUX)
+    CrashHandler::Install({SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL});
+#else
+    throw std::runtime_error("Crash handler is not supported on this platform!");
+#endif
+}
+
 // Should be called at the end of the logger work.
 // Usage of a log API after a call to this function is Undefined 
 void LogRegistry::ObpsLogShutdown()
 {
+#if defined(LINUX)
+    CrashHandler::RemoveOutputs();
+#endif
     GetDefaultQueueInstance()->ShutDown();
     GetLogRegistry()->WipeAllQueues();
+    if (s_SharedConsumer)
+    {
+        s_SharedConsumer->ShutDown();
+    }
     GetDefaultThreadPoolInstance()->ShutDown();
 }
 
@@ -76,6 +176,27 @@ LogQueueSptr LogRegistry::GetDefaultQueueInstance()
     return s_Instance;
 }
 
+/*
+*   Singleton Builder For SharedConsumer, threads are started on the first use.
+*/
+SharedConsumerSptr LogRegistry::GetSharedConsumerInstance()
+{
+    static std::once_flag s_Init;
+    std::call_once(s_Init, []{
+        s_SharedConsumer = SharedConsumer::Create(GetDefaultThreadPoolInstance(), default_consumer_threads, s_SharedConsumerThreadSpecs);
+    });
+    return s_SharedConsumer;
+}
+
+void LogRegistry::SetSharedConsumerThreadSpecs(const ThreadSpecs& thread_specs)
+{
+    if (s_SharedConsumer)
+    {
+        throw std::logic_error("Shared consumer threads have already been started!");
+    }
+    s_SharedConsumerThreadSpecs = std::make_shared<const ThreadSpecs>(thread_specs);
+}
+
 /*
 *   Singleton Builder For LogRegistry.
 */
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <future> // std::future
+#include <memory> // std::weak_ptr
+#include <mutex> // std::mutex
 #include <unordered_map> // std::unordered_map
+#include <utility> // std::pair
+#include <vector> // std::vector
 
 #include "log_def.hpp"
+#include "shared_consumer.hpp"
 
 namespace obps
 {
@@ -11,16 +17,44 @@ class LogRegistry final
 {
 public:
     static constexpr size_t default_queue_size = DEFAULT_QUEUE_SIZE;
+    static constexpr size_t default_batch_size = DEFAULT_BATCH_SIZE;
+    static constexpr size_t default_file_buffer_size = DEFAULT_FILE_BUFFER_SIZE;
+    static constexpr size_t default_map_chunk_size = DEFAULT_MAP_CHUNK_SIZE;
+    static constexpr size_t default_uring_buffers = DEFAULT_URING_BUFFERS;
+    static constexpr size_t default_consumer_threads = DEFAULT_CONSUMER_THREADS;
+    static constexpr size_t default_recorder_size = DEFAULT_RECORDER_SIZE;
 
     static LogPoolSptr GetDefaultThreadPoolInstance();
     static LogQueueSptr GetDefaultQueueInstance();
+    // consumer of the outputs that don't have own logger threads, runs in the default thread pool
+    static SharedConsumerSptr GetSharedConsumerInstance();
+    // must be called before the first use of the shared consumer
+    static void SetSharedConsumerThreadSpecs(const ThreadSpecs& thread_specs);
     
     using LogRegistrySptr = std::shared_ptr<LogRegistry>;
     static LogRegistrySptr GetLogRegistry();
 
-    LogQueueSptr CreateAndGetQueue(const std::string id, const size_t size);
+    LogQueueSptr CreateAndGetQueue(const std::string id, const size_t size, const LogQueue::Mode mode = LogQueue::Mode::SHARED, 
+        const size_t spill_size = 0);
     void WipeAllQueues();
 
+    // sink counters of an output that writes from a queue, kept while the output exists
+    void RegisterOutput(const std::string& queue_id, const std::shared_ptr<const SinkMetrics>& metrics);
+    // Counters of all outputs, cheap enough to be scraped periodically:
+    //  relaxed loads, writers and logger threads are never blocked by it
+    std::vector<OutputStats> GetOutputStats();
+
+    // Log::Flush of all registered outputs: messages written to any log before the call are written and flushed
+    // Waits without a limit, same as Log::Flush
+    void Flush(bool sync = false);
+    std::future<void> FlushAsync(bool sync = false);
+
+    // Opt-in: messages left in queues and file buffers are written to the log files 
+    //  when the process gets SIGSEGV, SIGABRT, SIGBUS, SIGFPE or SIGILL (see CrashHandler), Linux only.
+    // Previously installed handlers of these signals are called after the drain.
+    // Outputs of logs created before and after the call are drained, up to CrashHandler::max_outputs of them.
+    static void InstallCrashHandler();
+
     static std::string GenerateQueueUid();
     static void ObpsLogShutdown();
 
@@ -35,7 +69,9 @@ public:
     LogRegistry() = default;
     ~LogRegistry() = default;
 private:
-    std::unordered_map<std::string, LogQueueSptr> m_Queues;
+    std::mutex m_Mutex;
+    std::unordered_map<std::string, LogQueueSptr> m_Queues; // guarded by m_Mutex
+    std::vector<std::pair<std::string, std::weak_ptr<const SinkMetrics>>> m_Outputs; // guarded by m_Mutex
 };
 
 } // namespace obps
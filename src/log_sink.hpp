@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono> // std::chrono::steady_clock
+#include <memory> // std::shared_ptr
+#include <ostream> // std::ostream
+
+#include "log_metrics.hpp"
+
+namespace obps
+{
+
+// Output target of a logger thread, that receives formatted batches of messages.
+class LogSink
+{
+public:
+    virtual ~LogSink() = default;
+
+    // writes formatted batch of messages, may keep it buffered
+    virtual void Write(const char* data, size_t size) = 0;
+
+    // pushes buffered data to the target
+    // sync: batch contained *_SYNC message, data is expected to reach the storage
+    virtual void Flush(bool sync) = 0;
+
+    // waits until data passed by Write and Flush calls has been written,
+    //  overridden by sinks that complete writes asynchronously
+    virtual void Wait() {}
+
+    // Called by the crash handler while the logger thread is kept out of the sink:
+    //  writes buffered data and then the given data with async-signal-safe calls only.
+    // Returns false if the sink can't do that, as std::ostream targets
+    virtual bool EmergencyWrite(const char* /*data*/, size_t /*size*/) noexcept
+    {
+        return false;
+    }
+
+    virtual bool Failed() const noexcept = 0;
+};
+
+using LogSinkSptr = std::shared_ptr<LogSink>;
+
+// Writes to std::ostream: user provided streams and std::ofstream file targets
+class StreamSink final : public LogSink
+{
+public:
+    explicit StreamSink(std::shared_ptr<std::ostream> stream)
+        : m_Stream(std::move(stream))
+    {}
+
+    void Write(const char* data, size_t size) override
+    {
+        m_Stream->write(data, size);
+    }
+
+    void Flush(bool) override
+    {
+        m_Stream->flush();
+    }
+
+    bool Failed() const noexcept override
+    {
+        return m_Stream->fail();
+    }
+
+private:
+    std::shared_ptr<std::ostream> m_Stream;
+};
+
+// Counts bytes and times writes and flushes of another sink, once per batch
+class MeteredSink final : public LogSink
+{
+public:
+    MeteredSink(LogSinkSptr sink, std::shared_ptr<SinkMetrics> metrics)
+        : m_Sink(std::move(sink))
+        , m_Metrics(std::move(metrics))
+    {}
+
+    void Write(const char* data, size_t size) override
+    {
+        const auto start = Clock::now();
+        m_Sink->Write(data, size);
+        m_Metrics->WriteNanos.Record(ElapsedNanos(start));
+        m_Metrics->BytesWritten.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void Flush(bool sync) override
+    {
+        const auto start = Clock::now();
+        m_Sink->Flush(sync);
+        m_Metrics->FlushNanos.Record(ElapsedNanos(start));
+    }
+
+    void Wait() override
+    {
+        m_Sink->Wait();
+    }
+
+    bool EmergencyWrite(const char* data, size_t size) noexcept override
+    {
+        return m_Sink->EmergencyWrite(data, size);
+    }
+
+    bool Failed() const noexcept override
+    {
+        return m_Sink->Failed();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static uint64_t ElapsedNanos(const Clock::time_point start) noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    LogSinkSptr m_Sink;
+    std::shared_ptr<SinkMetrics> m_Metrics;
+};
+
+} // namespace obps
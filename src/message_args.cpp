@@ -0,0 +1,158 @@
+#include "message_args.hpp"
+
+#include <algorithm> // std::min, std::find
+#include <iterator> // std::size
+#include <cstring> // std::memcpy
+
+namespace obps
+{
+
+namespace
+{
+
+// stable indexes of the manipulators in packed arguments, new ones are only appended
+const IosManipulator standard_manipulators[] = {
+    std::boolalpha, std::noboolalpha,
+    std::showbase, std::noshowbase,
+    std::showpoint, std::noshowpoint,
+    std::showpos, std::noshowpos,
+    std::skipws, std::noskipws,
+    std::uppercase, std::nouppercase,
+    std::unitbuf, std::nounitbuf,
+    std::internal, std::left, std::right,
+    std::dec, std::hex, std::oct,
+    std::fixed, std::scientific, std::hexfloat, std::defaultfloat
+};
+
+// reads an argument value and streams it, returns false if the value is cut by the end
+template <typename T>
+bool UnpackValue(std::ostream& out, const char*& cursor, const char* const end)
+{
+    T value;
+    if (static_cast<size_t>(end - cursor) < sizeof(value))
+    {
+        return false;
+    }
+
+    std::memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    out << value;
+    return true;
+}
+
+bool UnpackManipulator(std::ostream& out, const char*& cursor, const char* const end)
+{
+    if (cursor == end)
+    {
+        return false;
+    }
+
+    const auto index = static_cast<uint8_t>(*cursor++);
+    if (index < std::size(standard_manipulators))
+    {
+        out << standard_manipulators[index];
+    }
+    return true;
+}
+
+bool SkipValue(const char*& cursor, const char* const end, const size_t size)
+{
+    if (static_cast<size_t>(end - cursor) < size)
+    {
+        return false;
+    }
+
+    cursor += size;
+    return true;
+}
+
+bool UnpackString(std::ostream& out, const char*& cursor, const char* const end)
+{
+    uint32_t length;
+    if (static_cast<size_t>(end - cursor) < sizeof(length))
+    {
+        return false;
+    }
+
+    std::memcpy(&length, cursor, sizeof(length));
+    cursor += sizeof(length);
+
+    const auto available = std::min<size_t>(length, end - cursor);
+    out.write(cursor, available);
+    cursor += available;
+    return true;
+}
+
+} // namespace
+
+void ArgsPacker::PackManipulator(const IosManipulator manipulator)
+{
+    const auto it = std::find(std::begin(standard_manipulators), std::end(standard_manipulators), manipulator);
+    if (it == std::end(standard_manipulators))
+    {
+        PutTag(ArgTag::USER_MANIPULATOR);
+        m_Buffer.append(reinterpret_cast<const char*>(&manipulator), sizeof(manipulator));
+        return;
+    }
+
+    PutTag(ArgTag::MANIPULATOR);
+    m_Buffer.push_back(static_cast<char>(it - std::begin(standard_manipulators)));
+}
+
+void ResetStream(std::ostringstream& stream)
+{
+    thread_local const std::ostringstream pristine;
+
+    auto buffer = std::move(stream).str();
+    buffer.clear();
+    stream.str(std::move(buffer));
+    stream.copyfmt(pristine);
+    stream.clear();
+}
+
+const char* UnpackArgs(const char* args, const size_t size, const bool in_process)
+{
+    thread_local std::ostringstream text;
+    ResetStream(text); // drop stream state left by previous message (std::hex, ...)
+
+    const char* cursor = args;
+    const char* const end = args + size;
+    bool unpacked = true;
+    while (unpacked && cursor < end)
+    {
+        const auto tag = static_cast<ArgTag>(*cursor++);
+        switch (tag)
+        {
+            case ArgTag::BOOL:        unpacked = UnpackValue<bool>(text, cursor, end); break;
+            case ArgTag::CHAR:        unpacked = UnpackValue<char>(text, cursor, end); break;
+            case ArgTag::SCHAR:       unpacked = UnpackValue<signed char>(text, cursor, end); break;
+            case ArgTag::UCHAR:       unpacked = UnpackValue<unsigned char>(text, cursor, end); break;
+            case ArgTag::SHORT:       unpacked = UnpackValue<short>(text, cursor, end); break;
+            case ArgTag::USHORT:      unpacked = UnpackValue<unsigned short>(text, cursor, end); break;
+            case ArgTag::INT:         unpacked = UnpackValue<int>(text, cursor, end); break;
+            case ArgTag::UINT:        unpacked = UnpackValue<unsigned int>(text, cursor, end); break;
+            case ArgTag::LONG:        unpacked = UnpackValue<long>(text, cursor, end); break;
+            case ArgTag::ULONG:       unpacked = UnpackValue<unsigned long>(text, cursor, end); break;
+            case ArgTag::LLONG:       unpacked = UnpackValue<long long>(text, cursor, end); break;
+            case ArgTag::ULLONG:      unpacked = UnpackValue<unsigned long long>(text, cursor, end); break;
+            case ArgTag::FLOAT:       unpacked = UnpackValue<float>(text, cursor, end); break;
+            case ArgTag::DOUBLE:      unpacked = UnpackValue<double>(text, cursor, end); break;
+            case ArgTag::LDOUBLE:     unpacked = UnpackValue<long double>(text, cursor, end); break;
+            case ArgTag::POINTER:     unpacked = UnpackValue<const void*>(text, cursor, end); break;
+            case ArgTag::MANIPULATOR: unpacked = UnpackManipulator(text, cursor, end); break;
+            case ArgTag::USER_MANIPULATOR:
+                unpacked = in_process 
+                    ? UnpackValue<IosManipulator>(text, cursor, end) 
+                    : SkipValue(cursor, end, sizeof(IosManipulator));
+                break;
+            case ArgTag::STRING:      unpacked = UnpackString(text, cursor, end); break;
+            default:
+                unpacked = false; // corrupted message, print what has been unpacked
+        }
+    }
+
+    text << '\0';
+    return text.view().data();
+}
+
+} // namespace obps
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint> // uint8_t, uint32_t
+#include <ios> // std::ios_base
+#include <sstream> // std::ostringstream
+#include <string> // std::string
+#include <string_view> // std::string_view
+#include <type_traits> // std::decay_t, std::is_object_v
+
+#include "ObpsLogConfig.hpp"
+
+namespace obps
+{
+
+// Type tags of the arguments packed into a message by the producer.
+// Each argument is stored as [tag][value], strings as [tag][uint32_t length][chars],
+// standard manipulators as [tag][uint8_t index] so that records stay meaningful outside of the process.
+enum class ArgTag : uint8_t
+{
+    BOOL,
+    CHAR, SCHAR, UCHAR,
+    SHORT, USHORT,
+    INT, UINT,
+    LONG, ULONG,
+    LLONG, ULLONG,
+    FLOAT, DOUBLE, LDOUBLE,
+    POINTER,
+    STRING,
+    MANIPULATOR,     // std::hex, std::boolalpha, ...
+    USER_MANIPULATOR // function address, valid only in the process that has written it
+};
+
+using IosManipulator = std::ios_base& (*)(std::ios_base&);
+
+// Describes how an argument type is stored in a message.
+// Types that are not packable are streamed by the producer (see PackArgs).
+template <typename T>
+struct ArgTraits
+{
+    static constexpr bool packable = false;
+};
+
+template <typename T, ArgTag Tag>
+struct ValueArgTraits
+{
+    static constexpr bool packable = true;
+    static constexpr ArgTag tag = Tag;
+    using StorageType = T;
+};
+
+template <> struct ArgTraits<bool>               : ValueArgTraits<bool, ArgTag::BOOL> {};
+template <> struct ArgTraits<char>               : ValueArgTraits<char, ArgTag::CHAR> {};
+template <> struct ArgTraits<signed char>        : ValueArgTraits<signed char, ArgTag::SCHAR> {};
+template <> struct ArgTraits<unsigned char>      : ValueArgTraits<unsigned char, ArgTag::UCHAR> {};
+template <> struct ArgTraits<short>              : ValueArgTraits<short, ArgTag::SHORT> {};
+template <> struct ArgTraits<unsigned short>     : ValueArgTraits<unsigned short, ArgTag::USHORT> {};
+template <> struct ArgTraits<int>                : ValueArgTraits<int, ArgTag::INT> {};
+template <> struct ArgTraits<unsigned int>       : ValueArgTraits<unsigned int, ArgTag::UINT> {};
+template <> struct ArgTraits<long>               : ValueArgTraits<long, ArgTag::LONG> {};
+template <> struct ArgTraits<unsigned long>      : ValueArgTraits<unsigned long, ArgTag::ULONG> {};
+template <> struct ArgTraits<long long>          : ValueArgTraits<long long, ArgTag::LLONG> {};
+template <> struct ArgTraits<unsigned long long> : ValueArgTraits<unsigned long long, ArgTag::ULLONG> {};
+template <> struct ArgTraits<float>              : ValueArgTraits<float, ArgTag::FLOAT> {};
+template <> struct ArgTraits<double>             : ValueArgTraits<double, ArgTag::DOUBLE> {};
+template <> struct ArgTraits<long double>        : ValueArgTraits<long double, ArgTag::LDOUBLE> {};
+template <> struct ArgTraits<IosManipulator>     : ValueArgTraits<IosManipulator, ArgTag::MANIPULATOR> {};
+
+template <> struct ArgTraits<const char*>        : ValueArgTraits<std::string_view, ArgTag::STRING> {};
+template <> struct ArgTraits<char*>              : ValueArgTraits<std::string_view, ArgTag::STRING> {};
+template <> struct ArgTraits<std::string>        : ValueArgTraits<std::string_view, ArgTag::STRING> {};
+template <> struct ArgTraits<std::string_view>   : ValueArgTraits<std::string_view, ArgTag::STRING> {};
+
+template <typename T>
+constexpr bool is_character_v = std::is_same_v<std::remove_cv_t<T>, char>
+    || std::is_same_v<std::remove_cv_t<T>, signed char> || std::is_same_v<std::remove_cv_t<T>, unsigned char>
+    || std::is_same_v<std::remove_cv_t<T>, wchar_t>     || std::is_same_v<std::remove_cv_t<T>, char8_t>
+    || std::is_same_v<std::remove_cv_t<T>, char16_t>    || std::is_same_v<std::remove_cv_t<T>, char32_t>;
+
+// object pointers are printed as addresses, character pointers are left to the stream
+template <typename T>
+struct ArgTraits<T*> : ValueArgTraits<const void*, ArgTag::POINTER>
+{
+    static constexpr bool packable = (std::is_object_v<T> || std::is_void_v<T>) && (! is_character_v<T>);
+};
+
+template <typename T>
+constexpr bool is_packable_v = ArgTraits<std::decay_t<T>>::packable;
+
+// Appends type-tagged arguments to a record buffer.
+// Buffer is expected to be reused between messages, so that its capacity is allocated once.
+class ArgsPacker
+{
+public:
+    explicit ArgsPacker(std::string& buffer) noexcept
+        : m_Buffer(buffer)
+    {}
+
+    template <typename T>
+    void Pack(const T& arg)
+    {
+        using Traits = ArgTraits<std::decay_t<T>>;
+
+        if constexpr (Traits::tag == ArgTag::STRING)
+        {
+            PackString(ToStringView(arg));
+        }
+        else if constexpr (Traits::tag == ArgTag::MANIPULATOR)
+        {
+            PackManipulator(arg);
+        }
+        else
+        {
+            const typename Traits::StorageType value = arg;
+            PutTag(Traits::tag);
+            m_Buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+    }
+
+    void PackString(std::string_view str)
+    {
+        const auto length = static_cast<uint32_t>(str.size());
+        PutTag(ArgTag::STRING);
+        m_Buffer.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        m_Buffer.append(str);
+    }
+
+    void PackManipulator(IosManipulator manipulator);
+
+private:
+    void PutTag(const ArgTag tag)
+    {
+        m_Buffer.push_back(static_cast<char>(tag));
+    }
+
+    static std::string_view ToStringView(const char* const str) noexcept
+    {
+        return str ? std::string_view(str) : std::string_view();
+    }
+
+    static std::string_view ToStringView(std::string_view str) noexcept
+    {
+        return str;
+    }
+
+    std::string& m_Buffer;
+};
+
+// Packs user arguments for the deferred formatting in the logger thread.
+// Falls back to streaming on the caller side when deferred formatting is disabled
+// or some of the arguments has no binary representation (user types, std::setw, ...).
+template <typename ...Args>
+void PackArgs(ArgsPacker& packer, const Args& ...args)
+{
+#ifdef DEFERRED_FORMATTING
+    if constexpr ((is_packable_v<Args> && ...))
+    {
+        (packer.Pack(args), ...);
+    }
+    else
+#endif // DEFERRED_FORMATTING
+    {
+        std::ostringstream serializer;
+        (serializer << ... << args);
+        packer.PackString(serializer.view());
+    }
+}
+
+// Clears content and format state of the stream, keeping its allocated buffer.
+void ResetStream(std::ostringstream& stream);
+
+// Formats packed arguments into a null terminated text, as if they were streamed one by one.
+// Arguments cut by the end of the buffer (truncated records) are skipped.
+// in_process: args were packed by this process, user manipulators are skipped otherwise.
+// Returned pointer stays valid until the next call from the same thread.
+const char* UnpackArgs(const char* args, size_t size, bool in_process = true);
+
+} // namespace obps
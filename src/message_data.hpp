@@ -1,8 +1,12 @@
 #pragma once
 
-#include <cstdlib> // std::memcpy
+#include <cstdint> // uint64_t
+#include <cstring> // std::memcpy
+#include <ostream> // std::ostream
 #include <thread> // std::thread::id
 
+#include "log_clock.hpp"
+
 namespace obps
 {
 
@@ -26,45 +30,75 @@ constexpr auto PrettyLevel(const LogLevel level)
     }
 }
 
+// number of configured levels, LogLevel values are 0 .. log_levels_count - 1
+struct LogLevelsCounter
+{
+    enum { OBPS_LOG_LEVELS, COUNT };
+};
+constexpr size_t log_levels_count = LogLevelsCounter::COUNT;
+
+// set of levels, one bit per LogLevel value
+using LevelMask = uint64_t;
+
+constexpr LevelMask LevelBit(const LogLevel level) noexcept
+{
+    return LevelMask{1} << static_cast<unsigned>(level);
+}
+
+// levels that are at least as severe as the given one
+constexpr LevelMask LevelsUpTo(const LogLevel level) noexcept
+{
+    return (LevelBit(level) << 1) - 1;
+}
+
+struct CallSite;
+
+// Header of a message record in a LogQueue.
+// Record layout: [MessageData][arguments packed by ArgsPacker], 
+// so a record takes as much queue memory as its arguments need.
 struct MessageData
 {
 public:
     // format function intarface allows user to provide custom formats to the log targets
-    using FormatFunction = void (std::ostream&, const std::time_t, const LogLevel, const std::thread::id, const char* text);
+    using FormatFunction = void (std::ostream&, const TimeStamp, const LogLevel, const std::thread::id, const char* text);
     using FormatFunctionPtr = FormatFunction*;
 private:
     friend class Log;
+    friend class CrashHandler;
 
-    static constexpr size_t text_field_size = 256;
-
-    std::time_t TimeStamp;
+    TimeStamp Time;
     LogLevel Level;
     std::thread::id Tid;
-    FormatFunctionPtr Format;
-    char Text[text_field_size];
     bool Sync; // used to enable flushes on write
+    bool Barrier = false; // record carries a FlushBarrier instead of message arguments
+    const CallSite* Site; // format call site, arguments are formatted by its format string
 
 public:
     MessageData() = default;
     
-    MessageData(const std::time_t ts, const LogLevel lvl, const std::thread::id tid, FormatFunctionPtr const fmt, const char * const src, bool sync = false)
-        : TimeStamp(ts)
+    MessageData(const TimeStamp ts, const LogLevel lvl, const std::thread::id tid, bool sync = false, 
+        const CallSite* site = nullptr)
+        : Time(ts)
         , Level(lvl)
         , Tid(tid)
-        , Format(fmt)
         , Sync(sync)
+        , Site(site)
+    {}
+
+    // header of a barrier record, ordered among messages by its timestamp
+    static MessageData FlushBarrier(const TimeStamp ts) noexcept
     {
-        std::memcpy(Text, src, text_field_size);
+        MessageData message(ts, LogLevel{}, std::this_thread::get_id());
+        message.Barrier = true;
+        return message;
     }
 
-    MessageData(const MessageData& other)
-        : TimeStamp(other.TimeStamp)
-        , Level(other.Level)
-        , Tid(other.Tid)
-        , Format(other.Format)
-        , Sync(other.Sync)
+    // reads header of a record, record memory may be unaligned
+    static MessageData FromRecord(const char* const record) noexcept
     {
-        std::memcpy(Text, other.Text, text_field_size);
+        MessageData message;
+        std::memcpy(&message, record, sizeof(MessageData));
+        return message;
     }
 }; // struct MessageData
 
@@ -0,0 +1,235 @@
+#include "message_format.hpp"
+
+#include <array> // std::array
+#include <cstring> // std::memcpy
+#include <iterator> // std::back_inserter
+#include <memory> // std::to_address
+#include <string> // std::string
+#include <tuple> // std::apply
+
+namespace obps
+{
+
+namespace
+{
+
+std::atomic<uint32_t> s_NextCallSiteId = 1;
+
+// arguments being formatted by FormatPackedArgs, read by the nested replacement fields of specs
+thread_local const std::array<FormatArg, max_format_args>* t_FormatArgs = nullptr;
+
+template <typename Storage, typename T = Storage>
+bool RestoreValue(FormatArg& arg, const char*& cursor, const char* const end)
+{
+    Storage value;
+    if (static_cast<size_t>(end - cursor) < sizeof(value))
+    {
+        return false;
+    }
+
+    std::memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    arg = static_cast<T>(value);
+    return true;
+}
+
+bool RestoreString(FormatArg& arg, const char*& cursor, const char* const end)
+{
+    uint32_t length;
+    if (static_cast<size_t>(end - cursor) < sizeof(length))
+    {
+        return false;
+    }
+
+    std::memcpy(&length, cursor, sizeof(length));
+    cursor += sizeof(length);
+
+    const auto available = std::min<size_t>(length, end - cursor);
+    arg = std::string_view(cursor, available);
+    cursor += available;
+    return true;
+}
+
+// Restores arguments packed by ArgsPacker, returns number of restored arguments
+size_t RestoreArgs(std::array<FormatArg, max_format_args>& values, const char* args, const size_t size)
+{
+    const char* cursor = args;
+    const char* const end = args + size;
+    size_t count = 0;
+    bool restored = true;
+    while (restored && cursor < end && count < values.size())
+    {
+        auto& arg = values[count];
+        switch (static_cast<ArgTag>(*cursor++))
+        {
+            case ArgTag::BOOL:    restored = RestoreValue<bool>(arg, cursor, end); break;
+            case ArgTag::CHAR:    restored = RestoreValue<char>(arg, cursor, end); break;
+            case ArgTag::SCHAR:   restored = RestoreValue<signed char, long long>(arg, cursor, end); break;
+            case ArgTag::UCHAR:   restored = RestoreValue<unsigned char, unsigned long long>(arg, cursor, end); break;
+            case ArgTag::SHORT:   restored = RestoreValue<short, long long>(arg, cursor, end); break;
+            case ArgTag::USHORT:  restored = RestoreValue<unsigned short, unsigned long long>(arg, cursor, end); break;
+            case ArgTag::INT:     restored = RestoreValue<int, long long>(arg, cursor, end); break;
+            case ArgTag::UINT:    restored = RestoreValue<unsigned int, unsigned long long>(arg, cursor, end); break;
+            case ArgTag::LONG:    restored = RestoreValue<long, long long>(arg, cursor, end); break;
+            case ArgTag::ULONG:   restored = RestoreValue<unsigned long, unsigned long long>(arg, cursor, end); break;
+            case ArgTag::LLONG:   restored = RestoreValue<long long>(arg, cursor, end); break;
+            case ArgTag::ULLONG:  restored = RestoreValue<unsigned long long>(arg, cursor, end); break;
+            case ArgTag::FLOAT:   restored = RestoreValue<float>(arg, cursor, end); break;
+            case ArgTag::DOUBLE:  restored = RestoreValue<double>(arg, cursor, end); break;
+            case ArgTag::LDOUBLE: restored = RestoreValue<long double>(arg, cursor, end); break;
+            case ArgTag::POINTER: restored = RestoreValue<const void*>(arg, cursor, end); break;
+            case ArgTag::STRING:  restored = RestoreString(arg, cursor, end); break;
+            default:
+                restored = false; // manipulators are rejected by the format string check
+        }
+        count += restored;
+    }
+    return count;
+}
+
+} // namespace
+
+uint32_t CallSite::GetId() const noexcept
+{
+    auto id = Id.load(std::memory_order_acquire);
+    if (id == 0)
+    {
+        const auto next = s_NextCallSiteId.fetch_add(1, std::memory_order_relaxed);
+        // another logger thread may have assigned it meanwhile
+        id = Id.compare_exchange_strong(id, next, std::memory_order_acq_rel) ? next : id;
+    }
+    return id;
+}
+
+const char* FormatPackedArgs(const std::string_view format, const char* const args, const size_t size)
+{
+    thread_local std::string text;
+    text.clear();
+
+    std::array<FormatArg, max_format_args> values;
+    RestoreArgs(values, args, size);
+
+    t_FormatArgs = &values;
+    try
+    {
+        std::apply([&format](auto& ...values) {
+            std::vformat_to(std::back_inserter(text), format, std::make_format_args(values...));
+        }, values);
+    }
+    catch (const std::format_error& error)
+    {
+        text.assign(format).append(" [format error: ").append(error.what()).append("]");
+    }
+    t_FormatArgs = nullptr;
+
+    return text.c_str();
+}
+
+} // namespace obps
+
+std::format_parse_context::iterator std::formatter<obps::FormatArg, char>::parse(std::format_parse_context& ctx)
+{
+    // specification is kept until the value type is known,
+    //  arguments of its nested fields are claimed now, so automatic numbering of the fields stays in order
+    auto it = ctx.begin();
+    while (it != ctx.end() && *it != '}')
+    {
+        if (*it++ != '{')
+        {
+            continue;
+        }
+
+        size_t id = 0;
+        if (it != ctx.end() && *it == '}')
+        {
+            id = ctx.next_arg_id();
+        }
+        else
+        {
+            while (it != ctx.end() && *it >= '0' && *it <= '9')
+            {
+                id = id * 10 + (*it++ - '0');
+            }
+            ctx.check_arg_id(id);
+        }
+
+        if (it == ctx.end() || *it != '}' || m_DynamicCount == m_DynamicArgs.size())
+        {
+            throw std::format_error("invalid nested replacement field of a format spec");
+        }
+        m_DynamicArgs[m_DynamicCount++] = id;
+        ++it;
+    }
+    m_Spec = std::string_view(std::to_address(ctx.begin()), it - ctx.begin());
+    return it;
+}
+
+// replaces nested fields of the spec by the values of their arguments
+std::string std::formatter<obps::FormatArg, char>::ResolveSpec() const
+{
+    if (! obps::t_FormatArgs)
+    {
+        throw std::format_error("nested replacement fields need packed arguments");
+    }
+
+    std::string resolved;
+    size_t dynamic = 0;
+    for (size_t i = 0; i < m_Spec.size(); ++i)
+    {
+        if (m_Spec[i] != '{')
+        {
+            resolved.push_back(m_Spec[i]);
+            continue;
+        }
+
+        const auto value = std::visit([](const auto& value) -> long long {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, long long>)
+            {
+                if (value < 0)
+                {
+                    throw std::format_error("negative width or precision");
+                }
+                return value;
+            }
+            else if constexpr (std::is_same_v<T, unsigned long long>)
+            {
+                return static_cast<long long>(value);
+            }
+            else
+            {
+                throw std::format_error("width or precision is not an integer");
+            }
+        }, (*obps::t_FormatArgs)[m_DynamicArgs[dynamic++]]);
+        resolved.append(std::to_string(value));
+        i = m_Spec.find('}', i);
+    }
+    return resolved;
+}
+
+std::format_context::iterator std::formatter<obps::FormatArg, char>::format(const obps::FormatArg& arg, std::format_context& ctx) const
+{
+    return std::visit([this, &ctx](const auto& value) {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<T, std::monostate>)
+        {
+            return ctx.out();
+        }
+        else
+        {
+            std::formatter<T, char> formatter;
+            if (m_DynamicCount == 0)
+            {
+                std::format_parse_context spec(m_Spec);
+                spec.advance_to(formatter.parse(spec));
+            }
+            else
+            {
+                const auto resolved = ResolveSpec();
+                std::format_parse_context spec(resolved);
+                spec.advance_to(formatter.parse(spec));
+            }
+            return formatter.format(value, ctx);
+        }
+    }, arg);
+}
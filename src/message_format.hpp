@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array> // std::array
+#include <atomic> // std::atomic
+#include <cstdint> // uint32_t
+#include <format> // std::formatter, std::format_context
+#include <string> // std::string
+#include <string_view> // std::string_view
+#include <variant> // std::variant, std::monostate
+
+#include "ObpsLogConfig.hpp"
+#include "message_args.hpp"
+#include "message_data.hpp"
+
+namespace obps
+{
+
+// Static descriptor of a std::format style log statement (see *_FMT macros).
+// Lives as long as the program, so that records refer to it instead of carrying the format string.
+struct CallSite
+{
+    std::string_view Format;
+    const char* File;
+    uint32_t Line;
+    LogLevel Level;
+
+    // process wide number of the call site, that is assigned on the first request
+    // binary outputs refer to call sites by it
+    uint32_t GetId() const noexcept;
+
+    mutable std::atomic<uint32_t> Id = 0;
+};
+
+// maximum number of arguments of a single format call
+constexpr size_t max_format_args = 16;
+
+// Arguments of a format call are packed into a record by their values and formatted by the logger thread,
+// arguments that have no binary representation make the whole message formatted on the caller side.
+template <typename ...Args>
+constexpr bool is_format_deferred_v =
+#ifdef DEFERRED_FORMATTING
+    (is_packable_v<Args> && ...);
+#else
+    false;
+#endif // DEFERRED_FORMATTING
+
+// Argument restored from a packed record, formatted by the std::formatter of the original type
+using FormatArg = std::variant<std::monostate,
+    bool, char, long long, unsigned long long, float, double, long double, const void*, std::string_view>;
+
+// Formats packed arguments by a format string into a null terminated text.
+// Invalid format specifications are reported in the text instead of throwing.
+// Returned pointer stays valid until the next call from the same thread.
+const char* FormatPackedArgs(std::string_view format, const char* args, size_t size);
+
+} // namespace obps
+
+// Applies format specification of the replacement field to the restored argument value
+template <>
+struct std::formatter<obps::FormatArg, char>
+{
+    std::format_parse_context::iterator parse(std::format_parse_context& ctx);
+    std::format_context::iterator format(const obps::FormatArg& arg, std::format_context& ctx) const;
+    std::string ResolveSpec() const;
+
+    std::string_view m_Spec;
+    // arguments of nested replacement fields of the spec (dynamic width and precision)
+    std::array<size_t, 2> m_DynamicArgs{};
+    size_t m_DynamicCount = 0;
+};
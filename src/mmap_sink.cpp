@@ -0,0 +1,129 @@
+#include "mmap_sink.hpp"
+
+#include <algorithm> // std::min
+#include <cstring> // std::memcpy
+#include <format> // std::format
+#include <stdexcept> // std::runtime_error
+
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap, msync, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // ftruncate, fdatasync, close, sysconf
+
+namespace obps
+{
+
+MmapSink::MmapSink(const std::filesystem::path& path, const size_t chunk_size)
+    : m_Fd(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644))
+    , m_ChunkSize(0)
+    , m_Chunk(nullptr)
+    , m_ChunkOffset(0)
+    , m_ChunkUsed(0)
+    , m_Unsynced(false)
+    , m_Failed(false)
+{
+    struct stat file_stat;
+    if (m_Fd < 0 || ::fstat(m_Fd, &file_stat) != 0)
+    {
+        throw std::runtime_error(std::format("Failed To Open LogFile! with path: {}", path.string()));
+    }
+
+    const size_t page_size = ::sysconf(_SC_PAGESIZE);
+    m_ChunkSize = std::max<size_t>((chunk_size + page_size - 1) / page_size, 1) * page_size;
+
+    // continue existing log from its end
+    const off_t offset = file_stat.st_size - file_stat.st_size % page_size;
+    if (! MapChunk(offset))
+    {
+        ::close(m_Fd);
+        throw std::runtime_error(std::format("Failed To Map LogFile! with path: {}", path.string()));
+    }
+    m_ChunkUsed = file_stat.st_size - offset;
+}
+
+MmapSink::~MmapSink()
+{
+    const off_t written = m_ChunkOffset + m_ChunkUsed;
+    if (m_Chunk)
+    {
+        ::msync(m_Chunk, m_ChunkUsed, MS_SYNC);
+        UnmapChunk();
+    }
+    ::ftruncate(m_Fd, written);
+    ::close(m_Fd);
+}
+
+void MmapSink::Write(const char* data, size_t size)
+{
+    while (size > 0 && ! m_Failed)
+    {
+        if (m_ChunkUsed == m_ChunkSize)
+        {
+            UnmapChunk();
+            m_Unsynced = true;
+            m_Failed = ! MapChunk(m_ChunkOffset + m_ChunkSize);
+            continue;
+        }
+
+        const size_t chunk = std::min(size, m_ChunkSize - m_ChunkUsed);
+        std::memcpy(m_Chunk + m_ChunkUsed, data, chunk);
+        m_ChunkUsed += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+// copying into the mapped chunk needs only ftruncate and mmap syscalls for the next chunks
+bool MmapSink::EmergencyWrite(const char* const data, const size_t size) noexcept
+{
+    Write(data, size);
+    return ! m_Failed;
+}
+
+// data is already in the page cache, only *_SYNC writes it to the storage
+void MmapSink::Flush(const bool sync)
+{
+    if (! sync || ! m_Chunk)
+    {
+        return;
+    }
+
+    if (::msync(m_Chunk, m_ChunkUsed, MS_SYNC) != 0)
+    {
+        m_Failed = true;
+    }
+
+    // previous chunks are not mapped anymore
+    if (m_Unsynced)
+    {
+        m_Failed |= ::fdatasync(m_Fd) != 0;
+        m_Unsynced = false;
+    }
+}
+
+bool MmapSink::MapChunk(const off_t offset)
+{
+    m_ChunkOffset = offset;
+    m_ChunkUsed = 0;
+    if (::ftruncate(m_Fd, offset + m_ChunkSize) != 0)
+    {
+        return false;
+    }
+
+    void* const chunk = ::mmap(nullptr, m_ChunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_Fd, offset);
+    if (chunk == MAP_FAILED)
+    {
+        return false;
+    }
+
+    m_Chunk = static_cast<char*>(chunk);
+    return true;
+}
+
+void MmapSink::UnmapChunk()
+{
+    ::munmap(m_Chunk, m_ChunkSize);
+    m_Chunk = nullptr;
+}
+
+} // namespace obps
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <filesystem> // std::filesystem::path
+#include <sys/types.h> // off_t
+
+#include "log_sink.hpp"
+
+namespace obps
+{
+
+// Writes into a memory mapped region of the log file, avoiding write syscalls and iostream.
+// File grows by fixed size chunks, only the current chunk is mapped.
+// msync is called only for *_SYNC messages and on destruction, when the file is also cut
+// to the written size. After a crash the file keeps every copied record and is padded with zeros
+// up to the end of the last chunk.
+class MmapSink final : public LogSink
+{
+public:
+    MmapSink(const std::filesystem::path& path, size_t chunk_size);
+    ~MmapSink() override;
+
+    void Write(const char* data, size_t size) override;
+    void Flush(bool sync) override;
+    bool EmergencyWrite(const char* data, size_t size) noexcept override;
+
+    bool Failed() const noexcept override
+    {
+        return m_Failed;
+    }
+
+    // Non-copyable
+    MmapSink(const MmapSink&) = delete;
+    MmapSink& operator=(const MmapSink&) = delete;
+
+    // Non-movable
+    MmapSink(MmapSink&&) = delete;
+    MmapSink& operator=(MmapSink&&) = delete;
+
+private:
+    // extends the file and maps chunk at the page aligned offset
+    bool MapChunk(off_t offset);
+    void UnmapChunk();
+
+    int m_Fd;
+    size_t m_ChunkSize;
+    char* m_Chunk;
+    off_t m_ChunkOffset;
+    size_t m_ChunkUsed;
+    bool m_Unsynced; // chunks have been unmapped since the last sync
+    bool m_Failed;
+};
+
+} // namespace obps
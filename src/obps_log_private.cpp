@@ -1,11 +1,32 @@
 #include "obps_log_private.hpp"
 
+#include <format> // std::format
+#include <sstream> // std::ostringstream
+
+#include "flush_barrier.hpp"
+#include "rotating_sink.hpp"
+
+
+#if defined(LINUX)
+#    include "crash_handler.hpp"
+#    include "file_sink.hpp"
+#    include "mmap_sink.hpp"
+#    include "uring_sink.hpp"
+#endif
+
 namespace obps
 {
 
+thread_local std::string Log::s_RecordBuffer;
+
 // Constructs Log instance from specialization object
-Log::Log(LogSpecs&& specs) : m_Pool(specs.GetLogPool())
+Log::Log(LogSpecs&& specs) 
+  : m_Pool(specs.GetLogPool())
+  , m_Clock(specs.GetClockSource())
+  , m_ThreadSpecs(specs.GetThreadSpecs())
 {
+    LogClock::Init(m_Clock);
+
     for (auto&& o_spec : specs.GetOutputSpecs())
     {
         AddOutput(o_spec);
@@ -13,33 +34,136 @@ Log::Log(LogSpecs&& specs) : m_Pool(specs.GetLogPool())
 }
 
 // Creates output target(file or stream) and spowns a logThread that will write to this target
+// Not Thread safe with writes: dispatch tables are updated without synchronization
 void Log::AddOutput(const LogSpecs::OutputSpecs& o_spec)
 {
     // important to store and then reference output when Running Task.
     auto&& output = m_Outputs.emplace_back(CreateOutput(o_spec));
+    const auto accepted = std::get<const LevelMask>(output);
+    for (size_t level = 0; level < m_LevelTargets.size(); level++)
+    {
+        if (accepted & LevelBit(static_cast<LogLevel>(level)))
+        {
+            m_LevelTargets[level].push_back({std::get<LogQueueSptr>(output), 
+                GetOverflow(o_spec.Overflow, static_cast<LogLevel>(level))});
+        }
+    }
+
+    {
+        std::lock_guard lock(m_LevelsMutex);
+        m_OutputLevels |= accepted;
+        UpdateEnabledLevels();
+    }
+
+    if (o_spec.UseSharedConsumer)
+    {
+        LogRegistry::GetSharedConsumerInstance()->AddOutput(std::get<LogQueueSptr>(output), 
+            [queue = std::get<LogQueueSptr>(output), sink = std::get<LogSinkSptr>(output), format = std::get<FormatFunctionPtr>(output),
+                encoder = std::get<BinaryEncoderSptr>(output), recorder = std::get<FlightRecorderSptr>(output), 
+                batch = std::get<BatchSpecs>(output)](bool& idle) {
+                return ServeOutput(queue, sink, format, encoder, recorder, batch, &idle);
+            });
+        return;
+    }
 
-    m_Pool->RunTask<LogQueueSptr, OstreamSptr>(
+    m_Pool->RunTask<LogQueueSptr, LogSinkSptr, FormatFunctionPtr, BinaryEncoderSptr, FlightRecorderSptr, BatchSpecs, ThreadSpecsSptr>(
         &Log::LogThread, 
         std::get<LogQueueSptr>(output),
-        std::get<OstreamSptr>(output)
+        std::get<LogSinkSptr>(output),
+        std::get<FormatFunctionPtr>(output),
+        std::get<BinaryEncoderSptr>(output),
+        std::get<FlightRecorderSptr>(output),
+        std::get<BatchSpecs>(output),
+        m_ThreadSpecs
     );
 }
 
-// Stores levels that will be ignored by this Log instance
-// Not Thread safe:
-//  designed to be called in the same thread where Log has been initialized
+// Stores levels that will be ignored by this Log instance, replacing previously muted ones
+// Thread safe: may be called while other threads write to the log
 void Log::Mute(const std::unordered_set<LogLevel>& mute_levels)
 {
-    m_MutedLevels = mute_levels;
+    LevelMask muted = 0;
+    for (const auto& level : mute_levels)
+    {
+        muted |= LevelBit(level);
+    }
+
+    std::lock_guard lock(m_LevelsMutex);
+    m_MutedLevels = muted;
+    UpdateEnabledLevels();
 }
 
 // Unmutes some levels, reanabling them for output
-// Not Thread safe: same as Mute
+// Thread safe: same as Mute
 void Log::Unmute(const std::set<LogLevel>& unmute_levels)
 {
+    std::lock_guard lock(m_LevelsMutex);
     for (const auto& level : unmute_levels)
     {
-        m_MutedLevels.erase(level);
+        m_MutedLevels &= ~LevelBit(level);
+    }
+    UpdateEnabledLevels();
+}
+
+// Not Thread safe with AddOutput, same as writes
+void Log::Flush(const bool sync)
+{
+    FlushAsync(sync).wait();
+}
+
+// Queues a flush barrier to every output, output whose sink has failed never passes it,
+//  so the wait may be limited by the future's wait_for
+std::future<void> Log::FlushAsync(const bool sync)
+{
+    std::vector<LogQueueSptr> queues;
+    queues.reserve(m_Outputs.size());
+    for (auto&& output : m_Outputs)
+    {
+        queues.push_back(std::get<LogQueueSptr>(output));
+    }
+    return FlushBarrier::Queue(queues, LogClock::Now(m_Clock), sync);
+}
+
+// Not Thread safe with AddOutput, same as Flush
+void Log::Dump()
+{
+    DumpAsync().wait();
+}
+
+// recorded messages are written when the barrier is read, in line with the messages queued before it
+std::future<void> Log::DumpAsync()
+{
+    std::vector<LogQueueSptr> queues;
+    queues.reserve(m_Outputs.size());
+    for (auto&& output : m_Outputs)
+    {
+        queues.push_back(std::get<LogQueueSptr>(output));
+    }
+    return FlushBarrier::Queue(queues, LogClock::Now(m_Clock), false, true);
+}
+
+void Log::UpdateEnabledLevels() noexcept
+{
+    // writers read only the mask itself, no other data is published with it
+    m_EnabledLevels.store(m_OutputLevels & ~m_MutedLevels, std::memory_order_relaxed);
+}
+
+// queue overflow behaviour of the output's messages of a level
+LogQueue::Overflow Log::GetOverflow(const LogSpecs::OverflowSpecs& overflow, const LogLevel level) noexcept
+{
+    using Policy = LogSpecs::OverflowSpecs::Policy;
+    switch (overflow.OnFull)
+    {
+        case Policy::DROP_NEWEST:
+            return LogQueue::Overflow::DROP_NEWEST;
+        case Policy::DROP_OLDEST:
+            return LogQueue::Overflow::DROP_OLDEST;
+        case Policy::DROP_BELOW_LEVEL:
+            return level <= overflow.KeepLevel ? LogQueue::Overflow::BLOCK : LogQueue::Overflow::DROP_NEWEST;
+        case Policy::SPILL:
+            return LogQueue::Overflow::SPILL;
+        default:
+            return LogQueue::Overflow::BLOCK;
     }
 }
 
@@ -47,40 +171,245 @@ void Log::Unmute(const std::set<LogLevel>& unmute_levels)
 Log::Output Log::CreateOutput(const LogBase::LogSpecs::OutputSpecs& o_spec)
 {
     const auto& target = o_spec.Target;
-    if (target.isPath())
+    const size_t spill_size = o_spec.Overflow.OnFull == LogSpecs::OverflowSpecs::Policy::SPILL ? o_spec.Overflow.SpillSize : 0;
+    auto&& queue = LogRegistry::GetLogRegistry()->CreateAndGetQueue(o_spec.QueueId, o_spec.QueueSize, o_spec.QueueMode, spill_size);
+    queue->SetWaitStrategy(o_spec.Wait);
+    const bool binary = o_spec.Format == &LogBase::BINARY;
+    BinaryEncoderSptr encoder;
+    if (binary)
+    {
+        encoder = std::make_shared<BinaryEncoder>();
+    }
+
+    const auto open_file = [file_specs = o_spec.File, binary](const fs::path& path){
+        return CreateFileSink(path, file_specs, binary);
+    };
+
+    LogSinkSptr sink;
+    const auto& rotation = o_spec.Rotation;
+    if (! target.isPath())
+    {
+        sink = std::make_shared<StreamSink>(std::make_shared<std::ostream>(target.getStream()->rdbuf()));
+        if (binary)
+        {
+            WriteBinaryHeader(*sink);
+        }
+    }
+    else if (rotation.MaxSize > 0 || rotation.Period != RotationPeriod::NONE)
     {
-        return std::make_tuple(o_spec.Level, o_spec.Mod, o_spec.Queue, o_spec.Format,
-            OpenFileStream(target.getPath()));
+        // each file of a rotated target starts with its own binary header and the call sites known so far
+        RotatingSink::HeaderFunc header;
+        if (encoder)
+        {
+            header = [encoder]{ return encoder->MakeFileHeader(); };
+        }
+        sink = std::make_shared<RotatingSink>(target.getPath(), rotation.MaxSize, rotation.Period, rotation.KeepFiles, 
+            open_file, std::move(header));
     }
     else
     {
-        return std::make_tuple(o_spec.Level, o_spec.Mod, o_spec.Queue, o_spec.Format, 
-            std::make_shared<std::ostream>(target.getStream()->rdbuf()));
+        sink = open_file(make_log_path(target.getPath()));
+        if (binary)
+        {
+            WriteBinaryHeader(*sink);
+        }
+    }
+
+    FlightRecorderSptr recorder;
+    if (o_spec.Recorder.Size > 0)
+    {
+        recorder = std::make_shared<FlightRecorder>(o_spec.Recorder.Size, o_spec.Recorder.WriteLevel, o_spec.Recorder.DumpLevel);
     }
+
+    auto metrics = std::make_shared<SinkMetrics>();
+    LogRegistry::GetLogRegistry()->RegisterOutput(o_spec.QueueId, metrics);
+    sink = std::make_shared<MeteredSink>(std::move(sink), std::move(metrics));
+#if defined(LINUX)
+    CrashHandler::AddOutput(queue, sink, encoder, recorder);
+#endif
+
+    // isolated output accepts only its own level, otherwise the level and more severe ones
+    const auto accepted = o_spec.Mod == LogSpecs::OutputModifier::ISOLATED 
+        ? LevelBit(o_spec.Level) 
+        : LevelsUpTo(o_spec.Level);
+
+    return std::make_tuple(o_spec.Level, o_spec.Mod, accepted, queue, o_spec.Format, encoder, recorder, sink, o_spec.Batch);
 }
 
-// thread function that runs in separate thread per each instance of a Log class
-LoggerThreadStatus Log::LogThread(LogQueueSptr queue, OstreamSptr output) 
+void Log::WriteBinaryHeader(LogSink& sink)
 {
-    // Constructing and writing to the stream inside syncronizing decorator
-    auto && status = queue->ReadTo([&output] (const char * const buffer, size_t size){
-        MessageData message;
-        LogQueue::Construct<MessageData>(&message, buffer);
+    const auto header = MakeBinaryHeader();
+    sink.Write(header.data(), header.size());
+}
+
+// creates sink of a log file according to its FileSpecs
+LogSinkSptr Log::CreateFileSink(const fs::path& path, const LogSpecs::FileSpecs& file_specs, const bool binary)
+{
+    using Sink = LogSpecs::FileSpecs::Sink;
+    switch (file_specs.SinkType)
+    {
+#if defined(LINUX)
+        case Sink::FD:
+            return std::make_shared<FileSink>(path, file_specs.BufferSize, file_specs.Alignment);
+        case Sink::MMAP:
+            return std::make_shared<MmapSink>(path, file_specs.ChunkSize);
+        case Sink::URING:
+#   if defined(IO_URING_SINK)
+            if (UringSink::Supported())
+            {
+                return std::make_shared<UringSink>(path, file_specs.BufferSize, file_specs.Buffers);
+            }
+#   endif
+            return std::make_shared<FileSink>(path, file_specs.BufferSize);
+#endif
+        case Sink::STREAM:
+            return std::make_shared<StreamSink>(OpenLogFile(path, binary ? std::ios::app | std::ios::binary : std::ios::app));
+        default:
+            throw std::runtime_error("File sink type is not supported on this platform!");
+    }
+}
+
+// thread function that runs in separate thread per each output of a Log class
+LoggerThreadStatus Log::LogThread(LogQueueSptr queue, LogSinkSptr output, FormatFunctionPtr format, 
+    BinaryEncoderSptr encoder, FlightRecorderSptr recorder, BatchSpecs batch_specs, ThreadSpecsSptr thread_specs) 
+{
+    ApplyThreadSpecsOnce(thread_specs);
+    return ServeOutput(queue, output, format, encoder, recorder, batch_specs, nullptr);
+}
+
+// Drains a batch of messages from the queue, formats them into a contiguous buffer
+// and passes the whole batch to the output with a single write.
+LoggerThreadStatus Log::ServeOutput(const LogQueueSptr& queue, const LogSinkSptr& output, const FormatFunctionPtr format, 
+    const BinaryEncoderSptr& encoder, const FlightRecorderSptr& recorder, const BatchSpecs& batch_specs, bool* const idle) 
+{
+    // pool thread may serve several outputs, but a batch is written before the next call
+    thread_local std::ostringstream batch;
+    ResetStream(batch);
+
+    bool sync = false;
+    bool in_batch = false;
+    std::vector<FlushBarrier*> barriers;
+    const auto write = [format, &encoder] (const char * const record, size_t size){
+        const auto message = MessageData::FromRecord(record);
+        const auto args = record + sizeof(MessageData);
+        const auto args_size = size - sizeof(MessageData);
+
+        if (encoder)
+        {
+            encoder->WriteMessage(batch, message.Time, message.Level, message.Tid, message.Site, args, args_size);
+        }
+        else
+        {
+            format(batch, message.Time, message.Level, message.Tid, message.Site 
+                ? FormatPackedArgs(message.Site->Format, args, args_size) 
+                : UnpackArgs(args, args_size));
+        }
+    };
+
+    // returns false for barriers, they aren't messages of the queue metrics
+    const auto read = [&queue, &write, &recorder, &sync, &in_batch, &barriers] (const char * const record, size_t size){
+        // records read from here on are lost if the crash handler drains the queue before they are written
+        if (! in_batch)
+        {
+            queue->BeginBatch();
+            in_batch = true;
+        }
+
+        const auto message = MessageData::FromRecord(record);
+        if (message.Barrier)
+        {
+            auto&& barrier = barriers.emplace_back(FlushBarrier::FromArgs(record + sizeof(MessageData)));
+            sync |= barrier->IsSync();
+            if (recorder && barrier->IsDump())
+            {
+                recorder->DumpTo(write);
+            }
+            return false;
+        }
+
+        if (recorder)
+        {
+            // recorded messages are formatted only if they are dumped
+            if (recorder->Records(message.Level))
+            {
+                recorder->Record(record, size);
+                return true;
+            }
+            if (recorder->Dumps(message.Level))
+            {
+                recorder->DumpTo(write);
+            }
+        }
+
+        write(record, size);
+        sync |= message.Sync;
+        return true;
+    };
+
+    const auto status = idle 
+        ? queue->TryReadBatchTo(read, batch_specs.MaxRecords, batch_specs.MaxLatency)
+        : queue->ReadBatchTo(read, batch_specs.MaxRecords, batch_specs.MaxLatency);
+    if (idle)
+    {
+        *idle = status == LogQueue::OperationStatus::EMPTY;
+    }
 
-        message.Format(*output, message.TimeStamp, message.Level, message.Tid, message.Text);
-        if (message.Sync)
+    const bool finished = status == LogQueue::OperationStatus::SHUTDOWN;
+    if (const auto dropped = queue->TakeDropped(finished ? std::chrono::steady_clock::duration::zero() : drop_report_period))
+    {
+        ReportDropped(batch, format, encoder.get(), dropped);
+    }
+
+    // sink is used below, unless the batch is empty and there is nothing to flush
+    if (! in_batch && (! batch.view().empty() || finished))
+    {
+        queue->BeginBatch();
+        in_batch = true;
+    }
+
+    const auto&& text = batch.view();
+    if (! text.empty())
+    {
+        output->Write(text.data(), text.size());
+    }
+    if (sync)
+    {
+        output->Flush(true);
+    }
+    else if (! barriers.empty())
+    {
+        output->Flush(false);
+    }
+
+    // barriers are passed once the sink has completed the writes, not just queued them
+    if (! barriers.empty())
+    {
+        output->Wait();
+        for (auto&& barrier : barriers)
         {
-            output->flush();
+            barrier->Pass();
         }
-    });
+    }
         
-    if (status == LogQueue::OperationStatus::SHUTDOWN)
+    if (finished)
     {
-        output->flush();
+        output->Flush(false);
+    }
+
+    if (in_batch)
+    {
+        queue->EndBatch();
+    }
+
+    if (finished)
+    {
+#if defined(LINUX)
+        CrashHandler::RemoveOutput(output.get());
+#endif
         return LoggerThreadStatus::FINISHED;
     }
 
-    if (output->fail())
+    if (output->Failed())
     {
         return LoggerThreadStatus::ABORTED;
     }
@@ -88,4 +417,24 @@ LoggerThreadStatus Log::LogThread(LogQueueSptr queue, OstreamSptr output)
     return LoggerThreadStatus::RUNNING;
 }
 
+// writes a message about dropped messages with the most severe level, so it passes any output
+void Log::ReportDropped(std::ostream& out, const FormatFunctionPtr format, BinaryEncoder* const encoder, const uint64_t dropped)
+{
+    const auto text = std::format("obps-log: {} messages have been dropped by a full queue", dropped);
+    const auto timestamp = LogClock::Now(ClockSource::SYSTEM);
+    const auto level = LogLevel{};
+
+    if (encoder)
+    {
+        std::string args;
+        ArgsPacker packer(args);
+        packer.PackString(text);
+        encoder->WriteMessage(out, timestamp, level, std::this_thread::get_id(), nullptr, args.data(), args.size());
+    }
+    else
+    {
+        format(out, timestamp, level, std::this_thread::get_id(), text.c_str());
+    }
+}
+
 } // namespace obps
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <array> // std::array
+#include <atomic> // std::atomic
+#include <future> // std::future
+#include <mutex> // std::mutex
 #include <unordered_set> // std::unordered_set
 #include <set> // std::set
-#include <sstream> // std::stringstream
 #include <string> // std::string
+#include <string_view> // std::string_view
 
 #include "log_base.hpp"
+#include "log_sink.hpp"
+#include "binary_format.hpp"
+#include "flight_recorder.hpp"
+#include "message_args.hpp"
+#include "message_format.hpp"
 
 namespace obps
 {
@@ -19,84 +28,176 @@ public:
     void AddOutput(const LogSpecs::OutputSpecs& o_spec);
 
     template <typename ...Args>
-    void Write(LogLevel level, bool sync, Args ...args);
+    void Write(LogLevel level, bool sync, const Args& ...args);
+
+    template <typename ...Args>
+    void WriteFormat(const CallSite& site, bool sync, std::format_string<const Args&...> fmt, const Args& ...args);
 
     void Mute(const std::unordered_set<LogLevel>& mute_levels);
     void Unmute(const std::set<LogLevel>& unmute_levels);
 
+    // Returns once the messages written before the call have been written by all outputs and flushed.
+    // sync: data is expected to reach the storage, as with *_SYNC messages
+    // The wait isn't bounded: an output whose logger thread has stopped (its sink has failed
+    //  or it has thrown) never passes the flush, use FlushAsync and wait_for to limit the wait.
+    void Flush(bool sync = false);
+    // same as Flush, but returns a future that becomes ready then
+    std::future<void> FlushAsync(bool sync = false);
+
+    // Same as Flush, but outputs with a flight recorder write the recorded messages first.
+    void Dump();
+    std::future<void> DumpAsync();
+
 private:
-    using OstreamSptr = std::shared_ptr<std::ostream>;
-    using LogThreadFunction = LoggerThreadStatus (LogQueueSptr, OstreamSptr);
+    using BatchSpecs = LogSpecs::BatchSpecs;
+    using LogThreadFunction = LoggerThreadStatus (LogQueueSptr, LogSinkSptr, FormatFunctionPtr, BinaryEncoderSptr, 
+        FlightRecorderSptr, BatchSpecs, ThreadSpecsSptr);
     
-    static LoggerThreadStatus LogThread(LogQueueSptr, OstreamSptr output);
+    static LoggerThreadStatus LogThread(LogQueueSptr, LogSinkSptr output, FormatFunctionPtr format, 
+        BinaryEncoderSptr encoder, FlightRecorderSptr recorder, BatchSpecs batch, ThreadSpecsSptr thread_specs);
+
+    // writes a batch of messages from the queue to the output,
+    //  waits for messages unless idle is provided, which is set if there were none
+    static LoggerThreadStatus ServeOutput(const LogQueueSptr& queue, const LogSinkSptr& output, FormatFunctionPtr format, 
+        const BinaryEncoderSptr& encoder, const FlightRecorderSptr& recorder, const BatchSpecs& batch, bool* idle);
+
+    // messages dropped by a full queue are reported by its output at most once per period
+    static constexpr std::chrono::seconds drop_report_period{1};
+    static void ReportDropped(std::ostream& out, FormatFunctionPtr format, BinaryEncoder* encoder, uint64_t dropped);
     
     using Output = std::tuple<
         const LogLevel, // severity level of the output target 
         const LogSpecs::OutputModifier, // isolate specific level   
+        const LevelMask, // levels accepted by the output
         LogQueueSptr, // output specific queue
         FormatFunctionPtr, // corresponding formatter 
-        OstreamSptr
+        BinaryEncoderSptr, // replaces formatter of the binary outputs
+        FlightRecorderSptr, // keeps verbose messages until a severe one, nullptr if off
+        LogSinkSptr, // stream or file target
+        BatchSpecs // how many messages are written at once
     >;
 
-    template <typename ...Args>
-    static MessageData BuildMessage(LogLevel level, FormatFunctionPtr format, bool sync, Args ...args);
+    template <typename Packer>
+    void WriteRecord(LogLevel level, bool sync, const CallSite* site, const Packer& pack);
+
+    template <typename Packer>
+    static std::string_view BuildMessage(TimeStamp timestamp, LogLevel level, bool sync, const CallSite* site, const Packer& pack);
+
+    // per thread buffer for message records, keeps its capacity between messages
+    static thread_local std::string s_RecordBuffer;
 
     static Output CreateOutput(const LogSpecs::OutputSpecs& o_spec);
+    static LogQueue::Overflow GetOverflow(const LogSpecs::OverflowSpecs& overflow, LogLevel level) noexcept;
+    static LogSinkSptr CreateFileSink(const fs::path& path, const LogSpecs::FileSpecs& file_specs, bool binary);
+    static void WriteBinaryHeader(LogSink& sink);
+
+    // recomputes enabled levels, called with m_LevelsMutex held
+    void UpdateEnabledLevels() noexcept;
 
     std::vector<Output> m_Outputs;
+    // queue of an output that accepts a level and what to do when it is full
+    struct LevelTarget
+    {
+        LogQueueSptr Queue;
+        LogQueue::Overflow OnFull;
+    };
+    // targets of the outputs that accept a level, indexed by the level
+    std::array<std::vector<LevelTarget>, log_levels_count> m_LevelTargets;
     LogPoolSptr m_Pool;
-    std::unordered_set<LogLevel> m_MutedLevels;
+    ClockSource m_Clock;
+    ThreadSpecsSptr m_ThreadSpecs;
+
+    // levels that reach at least one output and are not muted, 
+    //  checked by every write before anything else is done
+    std::atomic<LevelMask> m_EnabledLevels = 0;
+    LevelMask m_OutputLevels = 0;
+    LevelMask m_MutedLevels = 0;
+    std::mutex m_LevelsMutex; // serializes Mute/Unmute/AddOutput
 };
 
-// Checks message relevance to log's output targets by comparing levels and checking MutedLevels
-// then construct and write one message per relevant output.
-// Each message constructed from scratch using unique format per output 
-// and written into an output specific queue.
+// Writes a message of arguments that are streamed one by one
+template <typename ...Args>
+void Log::Write(LogLevel level, bool sync, const Args& ...args)
+{
+    WriteRecord(level, sync, nullptr, [&args...](ArgsPacker& packer) { 
+        PackArgs(packer, args...); 
+    });
+}
+
+// Writes a message of a *_FMT call site, format string is checked against the arguments at compile time.
+// Only the reference to the call site and argument values are passed through the queue,
+// unless some of the arguments are not packable, then the message is formatted here.
 template <typename ...Args>
-void Log::Write(LogLevel level, bool sync, Args ...args)
+void Log::WriteFormat(const CallSite& site, bool sync, std::format_string<const Args&...> fmt, const Args& ...args)
+{
+    static_assert(sizeof...(Args) <= max_format_args, "Too many arguments of a format call!");
+
+    if constexpr (is_format_deferred_v<Args...>)
+    {
+        WriteRecord(site.Level, sync, &site, [&args...](ArgsPacker& packer) { 
+            (packer.Pack(args), ...); 
+        });
+    }
+    else
+    {
+        WriteRecord(site.Level, sync, nullptr, [&fmt, &args...](ArgsPacker& packer) { 
+            packer.PackString(std::format(fmt, args...)); 
+        });
+    }
+}
+
+// Checks message relevance to log's output targets with a single load of the enabled levels mask,
+// then constructs a single message record and writes a copy of it into the queue of each output 
+// that accepts the level, as listed by the level's dispatch table.
+// Arguments, timestamp and thread id are captured once per call, 
+// formatting is done by each output's LogThread with its own format function.
+template <typename Packer>
+void Log::WriteRecord(LogLevel level, bool sync, const CallSite* site, const Packer& pack)
 {
-    for(auto && [lvl, mod, que, fmt, out] : m_Outputs)
+    if ((m_EnabledLevels.load(std::memory_order_relaxed) & LevelBit(level)) == 0)
     {
-        if (lvl >= level && (! m_MutedLevels.contains(level)))
-        {
-            que->WriteEmplace<MessageData>(std::move(BuildMessage(level, fmt, sync, args...)));
-        }
+        return;
+    }
+
+    const auto timestamp = LogClock::Now(m_Clock);
+    const auto record = BuildMessage(timestamp, level, sync, site, pack);
+    for(auto && target : m_LevelTargets[static_cast<size_t>(level)])
+    {
+        target.Queue->Write(record.data(), record.size(), timestamp.time_since_epoch().count(), target.OnFull);
     }
 }
 
-// Helper that parses user arguments and creates MessageData that will be passed into a output's queue.
+// Helper that packs user arguments into a message record that will be passed into output's queues.
+// Arguments are stored in binary form and formatted into a text later by the LogThread,
+// unless deferred formatting is disabled (see PackArgs).
 //
 // Params:
+//  TimeStamp timestamp:        time of the message.
 //  LogLevel level:             message level to be displayed in log.
-//  FormatFunctionPtr format:   format function that will be used for final message composing before write.
 //  bool sync:                  flag that indicates whenever need to flush output stream after mesasge writing.
-//  Args ...args:               any args that user provide that will become part of a message.
+//  const CallSite* site:       format call site of the message, nullptr for streamed arguments.
+//  Packer pack:                appends arguments that user provide to the record with ArgsPacker.
 //
 // Return: 
-//  MessageData:                struct that will be moved into a output's queue
-template <typename ...Args>
-MessageData Log::BuildMessage(LogLevel level, FormatFunctionPtr format, bool sync, Args ...args)
+//  std::string_view:           record [MessageData][packed args] valid until the next call from the same thread
+template <typename Packer>
+std::string_view Log::BuildMessage(TimeStamp timestamp, LogLevel level, bool sync, const CallSite* site, const Packer& pack)
 {
-    std::stringstream serializer;
-    std::string text;
-
-	(serializer << ... << args);
-    std::getline(serializer, text, '\0');
-
-    assert(text.size() <= MessageData::text_field_size);
-
-    //TODO: Check size of the text
-
-    auto&& message_data = MessageData{ 
-        get_timestamp(),
+    const MessageData message_data{ 
+        timestamp,
         level, 
         std::this_thread::get_id(),
-        format,
-        text.c_str(),
-        sync
+        sync,
+        site
     };
 
-    return message_data;
+    auto& record = s_RecordBuffer;
+    record.assign(reinterpret_cast<const char*>(&message_data), sizeof(MessageData));
+
+    ArgsPacker packer(record);
+    pack(packer);
+
+    return record;
 }
 
-} // namespace obps
\ No newline at end of file
+} // namespace obps
@@ -24,6 +24,11 @@
     *   or another scope that will limit log opperation.
     */
     #define OBPS_LOG_TEARDOWN() obps::LogRegistry::ObpsLogShutdown()
+
+    /*
+    *   Wait until messages written before are written and flushed by the outputs of all logs.
+    */
+    #define OBPS_LOG_FLUSH() obps::LogRegistry::GetLogRegistry()->Flush()
     
     /*
     *   Create log in global scope.
@@ -35,6 +40,8 @@
 
     #define G_MUTE(...) get_global_log().Mute({__VA_ARGS__})
     #define G_UNMUTE(...) get_global_log().Unmute({__VA_ARGS__})
+    #define G_FLUSH() get_global_log().Flush()
+    #define G_DUMP() get_global_log().Dump()
 
     /*
     *   Call at the beginning of the logging scope
@@ -44,8 +51,25 @@
 
     #define MUTE(...) _SCOPE_LOG_ID.Mute({__VA_ARGS__})
     #define UNMUTE(...) _SCOPE_LOG_ID.Unmute({__VA_ARGS__})
+    #define FLUSH() _SCOPE_LOG_ID.Flush()
+    #define DUMP() _SCOPE_LOG_ID.Dump()
+
+    /*
+    *   std::format style log statement: *_FMT("{} of {}", a, b)
+    *   format string must be a literal, it is checked against the arguments at compile time
+    *   and stored in a static call site descriptor together with file, line and level.
+    */
+    #define OBPS_LOG_EXPAND(x) x
+    #define OBPS_LOG_FIRST(first, ...) first
+    #define OBPS_LOG_FORMAT(log, level, sync, ...) \
+        do { \
+            static constinit obps::CallSite _obps_call_site{ \
+                OBPS_LOG_EXPAND(OBPS_LOG_FIRST(__VA_ARGS__, ~)), __FILE__, __LINE__, level}; \
+            (log).WriteFormat(_obps_call_site, sync, __VA_ARGS__); \
+        } while (false)
 #else
     #define OBPS_LOG_TEARDOWN() {}
+    #define OBPS_LOG_FLUSH() {}
     #define GLOBAL_LOG(...)
     #define SCOPE_LOG(...)
 
@@ -53,5 +77,9 @@
     #define G_MUTE(...) {}
     #define UNMUTE(...) {}
     #define G_UNMUTE(...) {}
+    #define FLUSH() {}
+    #define G_FLUSH() {}
+    #define DUMP() {}
+    #define G_DUMP() {}
 
 #endif // LOG_ON
\ No newline at end of file
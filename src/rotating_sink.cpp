@@ -0,0 +1,341 @@
+#include "rotating_sink.hpp"
+
+#include <algorithm> // std::sort, std::all_of
+#include <cctype> // std::isdigit
+#include <charconv> // std::from_chars
+#include <format> // std::format
+#include <limits> // std::numeric_limits
+#include <system_error> // std::error_code
+#include <string_view> // std::string_view
+#include <utility> // std::exchange
+#include <vector> // std::vector
+
+#include "log_base.hpp"
+
+namespace obps
+{
+
+namespace
+{
+
+// text has count digits at the position
+bool IsDigits(const std::string_view text, const size_t position, const size_t count)
+{
+    return position + count <= text.size() && std::all_of(text.begin() + position, text.begin() + position + count,
+        [](unsigned char c){ return std::isdigit(c); });
+}
+
+// Parses a name made by RotatingSink::FilePath: <prefix>-YYYY-MM-DD[-HH][.<n>].log,
+//  period: YYYY-MM-DD[-HH], index: <n>, 0 if there is none. Names of other logs don't match,
+//  even if they start with the prefix and a digit.
+bool ParseFileName(const std::string_view name, const std::string_view prefix, std::string_view& period, size_t& index)
+{
+    constexpr std::string_view extension = ".log";
+    if (name.size() <= prefix.size() + 1 + extension.size() || ! name.starts_with(prefix) || name[prefix.size()] != '-'
+        || ! name.ends_with(extension))
+    {
+        return false;
+    }
+    const auto rest = name.substr(prefix.size() + 1, name.size() - prefix.size() - 1 - extension.size());
+
+    // YYYY-MM-DD
+    if (rest.size() < 10 || ! IsDigits(rest, 0, 4) || rest[4] != '-' || ! IsDigits(rest, 5, 2) || rest[7] != '-' || ! IsDigits(rest, 8, 2))
+    {
+        return false;
+    }
+    size_t position = 10;
+    // -HH
+    if (position < rest.size() && rest[position] == '-')
+    {
+        if (! IsDigits(rest, position + 1, 2))
+        {
+            return false;
+        }
+        position += 3;
+    }
+    period = rest.substr(0, position);
+
+    index = 0;
+    if (position == rest.size())
+    {
+        return true;
+    }
+    // .<n>
+    if (rest[position] != '.' || position + 1 == rest.size() || ! IsDigits(rest, position + 1, rest.size() - position - 1))
+    {
+        return false;
+    }
+    const auto result = std::from_chars(rest.data() + position + 1, rest.data() + rest.size(), index);
+    return result.ec == std::errc{};
+}
+
+// removes the oldest files of the prefix, so that keep_files of them remain, including the current one
+void RemoveOldFiles(const fs::path& dir, const std::string& prefix, const size_t keep_files, const fs::path& current)
+{
+    struct File
+    {
+        fs::file_time_type Time;
+        fs::path Path;
+        std::string Period; // <date>[-<hour>]
+        size_t Index;       // .<n>, 0 if there is none
+    };
+
+    std::error_code error;
+    std::vector<File> files;
+    for (const auto& entry : fs::directory_iterator(dir, error))
+    {
+        const auto name = entry.path().filename().string();
+        std::string_view period;
+        size_t index;
+        if (ParseFileName(name, prefix, period, index) && entry.is_regular_file(error) && entry.path() != current)
+        {
+            files.push_back({entry.last_write_time(error), entry.path(), std::string(period), index});
+        }
+    }
+
+    if (files.size() < keep_files)
+    {
+        return;
+    }
+
+    // newest first, files of the same time by period and then by the numeric index (.10 is newer than .9)
+    std::sort(files.begin(), files.end(), [](const File& lhs, const File& rhs){
+        if (lhs.Time != rhs.Time)
+        {
+            return lhs.Time > rhs.Time;
+        }
+        return lhs.Period != rhs.Period ? lhs.Period > rhs.Period : lhs.Index > rhs.Index;
+    });
+    for (size_t i = keep_files - 1; i < files.size(); i++)
+    {
+        fs::remove(files[i].Path, error);
+    }
+}
+
+} // namespace
+
+RotatingSink::RotatingSink(const fs::path& path, const size_t max_size, const RotationPeriod period,
+    const size_t keep_files, SinkFactory factory, HeaderFunc header)
+    : m_Dir(path.parent_path())
+    , m_Prefix(path.filename().string())
+    , m_MaxSize(max_size)
+    , m_Period(period)
+    , m_KeepFiles(keep_files)
+    , m_Factory(std::move(factory))
+    , m_Header(std::move(header))
+    , m_Index(0)
+    , m_Written(0)
+    , m_Started(0)
+{
+    const auto now = std::time(nullptr);
+    m_PeriodName = PeriodName(now);
+    m_PeriodEnd = PeriodEnd(now);
+
+    std::error_code error;
+    // continue the last file of the period
+    while (fs::exists(FilePath(m_PeriodName, m_Index + 1), error))
+    {
+        m_Index++;
+    }
+    m_Path = FilePath(m_PeriodName, m_Index);
+
+    const auto size = fs::file_size(m_Path, error);
+    m_Written = error ? 0 : size;
+    m_Sink = m_Factory(m_Path);
+    WriteHeader();
+}
+
+RotatingSink::~RotatingSink()
+{
+    // file opened ahead of time has never been written
+    if (m_Next.Sink.valid())
+    {
+        try
+        {
+            m_Next.Sink.get().reset();
+            std::error_code error;
+            fs::remove(m_Next.Path, error);
+        }
+        catch (...)
+        {}
+    }
+
+    if (m_Retired.valid())
+    {
+        m_Retired.wait();
+    }
+}
+
+void RotatingSink::Write(const char* data, const size_t size)
+{
+    const auto now = std::time(nullptr);
+    // file that has nothing but its header takes the data, however large it is
+    const bool full = m_MaxSize > 0 && m_Written > m_Started && m_Written + size > m_MaxSize;
+    if (full || now >= m_PeriodEnd)
+    {
+        Rotate(now);
+    }
+    else if (! m_Next.Sink.valid())
+    {
+        if (now + prepare_ahead >= m_PeriodEnd)
+        {
+            Prepare(m_PeriodEnd);
+        }
+        else if (m_MaxSize > 0 && m_Written >= m_MaxSize / 4 * 3)
+        {
+            Prepare(now);
+        }
+    }
+
+    m_Sink->Write(data, size);
+    m_Written += size;
+}
+
+void RotatingSink::Flush(const bool sync)
+{
+    m_Sink->Flush(sync);
+}
+
+void RotatingSink::Wait()
+{
+    m_Sink->Wait();
+    if (m_Retired.valid())
+    {
+        m_Retired.wait();
+    }
+}
+
+bool RotatingSink::Failed() const noexcept
+{
+    return m_Sink->Failed();
+}
+
+std::string RotatingSink::PeriodName(const std::time_t stamp) const
+{
+    return get_time_string(m_Period == RotationPeriod::HOURLY ? "%F-%H" : "%F", stamp);
+}
+
+std::time_t RotatingSink::PeriodEnd(const std::time_t stamp) const
+{
+    if (m_Period == RotationPeriod::NONE)
+    {
+        return std::numeric_limits<std::time_t>::max();
+    }
+
+    // start of the next hour or day in local time, mktime normalizes overflowing fields
+    tm date_info;
+    __localtime(&date_info, &stamp);
+    date_info.tm_sec = 0;
+    date_info.tm_min = 0;
+    if (m_Period == RotationPeriod::DAILY)
+    {
+        date_info.tm_hour = 0;
+        date_info.tm_mday++;
+    }
+    else
+    {
+        date_info.tm_hour++;
+    }
+    date_info.tm_isdst = -1;
+    return std::mktime(&date_info);
+}
+
+fs::path RotatingSink::FilePath(const std::string& period, const size_t index) const
+{
+    return m_Dir / (index == 0
+        ? std::format("{}-{}.log", m_Prefix, period)
+        : std::format("{}-{}.{}.log", m_Prefix, period, index));
+}
+
+size_t RotatingSink::FreeIndex(const std::string& period, size_t index) const
+{
+    std::error_code error;
+    while (fs::exists(FilePath(period, index), error))
+    {
+        index++;
+    }
+    return index;
+}
+
+void RotatingSink::Prepare(const std::time_t stamp)
+{
+    m_Next.Period = PeriodName(stamp);
+    m_Next.Index = FreeIndex(m_Next.Period, m_Next.Period == m_PeriodName ? m_Index + 1 : 0);
+    m_Next.Path = FilePath(m_Next.Period, m_Next.Index);
+    m_Next.Sink = std::async(std::launch::async, m_Factory, m_Next.Path);
+}
+
+void RotatingSink::Rotate(const std::time_t stamp)
+{
+    if (! m_Next.Sink.valid())
+    {
+        Prepare(stamp); // rotation came without a warning, logger thread waits for the file
+    }
+
+    LogSinkSptr next;
+    try
+    {
+        next = m_Next.Sink.get();
+    }
+    catch (...)
+    {
+        // the current file goes on, next attempt is after another max size or period
+        m_Written = 0;
+        m_PeriodEnd = PeriodEnd(stamp);
+        return;
+    }
+
+    // file prepared for a size limit, while the period has ended, gets the name of the new period
+    const auto period = PeriodName(stamp);
+    if (m_Next.Period != period)
+    {
+        const auto index = FreeIndex(period, 0);
+        std::error_code error;
+        fs::rename(m_Next.Path, FilePath(period, index), error);
+        if (! error)
+        {
+            m_Next.Path = FilePath(period, index);
+            m_Next.Period = period;
+            m_Next.Index = index;
+        }
+    }
+
+    Retire(std::exchange(m_Sink, std::move(next)));
+    m_Path = m_Next.Path;
+    m_PeriodName = m_Next.Period;
+    m_Index = m_Next.Index;
+    m_Written = 0;
+    m_PeriodEnd = PeriodEnd(stamp);
+    WriteHeader();
+}
+
+// header goes through the size count, so files with headers keep to the max size as well
+void RotatingSink::WriteHeader()
+{
+    if (m_Header)
+    {
+        const auto header = m_Header();
+        m_Sink->Write(header.data(), header.size());
+        m_Written += header.size();
+    }
+    m_Started = m_Written;
+}
+
+void RotatingSink::Retire(LogSinkSptr sink)
+{
+    if (m_Retired.valid())
+    {
+        m_Retired.wait();
+    }
+
+    m_Retired = std::async(std::launch::async,
+        [sink = std::move(sink), dir = m_Dir, prefix = m_Prefix, keep_files = m_KeepFiles, current = m_Next.Path]() mutable {
+            sink.reset(); // previous file is flushed and closed
+            if (keep_files > 0)
+            {
+                RemoveOldFiles(dir, prefix, keep_files, current);
+            }
+        });
+}
+
+} // namespace obps
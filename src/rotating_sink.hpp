@@ -0,0 +1,113 @@
+#pragma once
+
+#include <ctime> // std::time_t
+#include <filesystem> // std::filesystem::path
+#include <functional> // std::function
+#include <future> // std::future
+#include <string> // std::string
+
+#include "log_sink.hpp"
+
+namespace obps
+{
+
+enum class RotationPeriod
+{
+    NONE,
+    HOURLY,
+    DAILY
+};
+
+// Moves a path target to a new file once the current one reaches a size or a period of time ends,
+// and keeps a limited number of files.
+// Files are named <dir>/<prefix>-<period>.log and <dir>/<prefix>-<period>.<n>.log for the following files
+// of the same period, where period is the local date, with the hour for hourly rotation.
+//
+// Rotation happens between batches in the logger thread, writers never wait for it.
+// Next file is opened ahead of time by a background task, so the logger thread only swaps sinks,
+// closing of the previous file and removal of files over the retention count happen in the background as well.
+class RotatingSink final : public LogSink
+{
+public:
+    // opens a sink that writes to a file path
+    using SinkFactory = std::function<LogSinkSptr(const std::filesystem::path&)>;
+    // data that starts each file, called by the logger thread when the file becomes the current one
+    using HeaderFunc = std::function<std::string()>;
+
+    // next file is opened once the current one is filled to 3/4 of max size,
+    //  or this many seconds before the period ends
+    static constexpr std::time_t prepare_ahead = 5;
+
+    // path: <dir>/<prefix>, max_size: bytes per file including the header, 0 - unlimited, keep_files: 0 - keep all
+    // header: empty for files without one
+    RotatingSink(const std::filesystem::path& path, size_t max_size, RotationPeriod period, size_t keep_files,
+        SinkFactory factory, HeaderFunc header = {});
+    ~RotatingSink() override;
+
+    void Write(const char* data, size_t size) override;
+    void Flush(bool sync) override;
+    // also waits until the retired file is closed and old files are removed
+    void Wait() override;
+    // goes to the current file, whatever its size or period is
+    bool EmergencyWrite(const char* data, size_t size) noexcept override
+    {
+        return m_Sink->EmergencyWrite(data, size);
+    }
+    bool Failed() const noexcept override;
+
+    const std::filesystem::path& GetPath() const noexcept
+    {
+        return m_Path;
+    }
+
+    // Non-copyable
+    RotatingSink(const RotatingSink&) = delete;
+    RotatingSink& operator=(const RotatingSink&) = delete;
+
+    // Non-movable
+    RotatingSink(RotatingSink&&) = delete;
+    RotatingSink& operator=(RotatingSink&&) = delete;
+
+private:
+    struct NextFile
+    {
+        std::future<LogSinkSptr> Sink;
+        std::filesystem::path Path;
+        std::string Period;
+        size_t Index = 0;
+    };
+
+    std::string PeriodName(std::time_t stamp) const;
+    std::time_t PeriodEnd(std::time_t stamp) const;
+    std::filesystem::path FilePath(const std::string& period, size_t index) const;
+    // first index of the period, starting from a given one, that isn't taken by an existing file
+    size_t FreeIndex(const std::string& period, size_t index) const;
+
+    // starts opening the file that follows the current one at a given time
+    void Prepare(std::time_t stamp);
+    void Rotate(std::time_t stamp);
+    // closes the previous file and removes files over the retention count
+    void Retire(LogSinkSptr sink);
+    void WriteHeader();
+
+    const std::filesystem::path m_Dir;
+    const std::string m_Prefix;
+    const size_t m_MaxSize;
+    const RotationPeriod m_Period;
+    const size_t m_KeepFiles;
+    const SinkFactory m_Factory;
+    const HeaderFunc m_Header;
+
+    LogSinkSptr m_Sink;
+    std::filesystem::path m_Path;
+    std::string m_PeriodName;
+    size_t m_Index;
+    size_t m_Written;       // size of the current file
+    size_t m_Started;       // size of the current file once its header has been written
+    std::time_t m_PeriodEnd;
+
+    NextFile m_Next;
+    std::future<void> m_Retired;
+};
+
+} // namespace obps
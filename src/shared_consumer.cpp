@@ -0,0 +1,121 @@
+#include "shared_consumer.hpp"
+
+#include <algorithm> // std::max
+
+namespace obps
+{
+
+SharedConsumerSptr SharedConsumer::Create(LogPoolSptr pool, const size_t threads, ThreadSpecsSptr thread_specs)
+{
+    auto consumer = std::make_shared<SharedConsumer>();
+    consumer->m_ThreadSpecs = std::move(thread_specs);
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); i++)
+    {
+        pool->RunTask<SharedConsumerSptr>(&SharedConsumer::ConsumerThread, consumer);
+    }
+    return consumer;
+}
+
+void SharedConsumer::AddOutput(const LogQueueSptr& queue, ServeFunction serve)
+{
+    queue->SetDoorbell(m_Doorbell);
+
+    auto output = std::make_shared<Output>();
+    output->Serve = std::move(serve);
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Outputs.push_back(std::move(output));
+        m_Generation.fetch_add(1, std::memory_order_release);
+    }
+    m_Doorbell->Ring();
+}
+
+void SharedConsumer::ShutDown()
+{
+    m_ShutDown.store(true);
+    m_Doorbell->Ring();
+}
+
+void SharedConsumer::RemoveOutput(const OutputSptr& output)
+{
+    std::lock_guard lock(m_Mutex);
+    std::erase(m_Outputs, output);
+    m_Generation.fetch_add(1, std::memory_order_release);
+}
+
+bool SharedConsumer::IsFinished()
+{
+    std::lock_guard lock(m_Mutex);
+    return m_ShutDown && m_Outputs.empty();
+}
+
+bool SharedConsumer::ServeOutputs(std::vector<OutputSptr>& outputs)
+{
+    thread_local size_t start = 0;
+    start++;
+
+    bool idle = true;
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        auto& output = outputs[(start + i) % outputs.size()];
+        if (! output || output->Busy.test_and_set(std::memory_order_acquire))
+        {
+            continue; // removed, or served by another thread
+        }
+
+        bool output_idle = false;
+        const auto status = output->Serve(output_idle);
+        output->Busy.clear(std::memory_order_release);
+
+        idle &= output_idle;
+        if (status != LoggerThreadStatus::RUNNING)
+        {
+            RemoveOutput(output);
+            output.reset();
+        }
+    }
+    return idle;
+}
+
+// Doorbell is armed before the last check of the outputs,
+// so a message written after the check rings it and the thread doesn't sleep through it.
+LoggerThreadStatus SharedConsumer::ConsumerThread(SharedConsumerSptr consumer)
+{
+    ApplyThreadSpecsOnce(consumer->m_ThreadSpecs);
+
+    thread_local std::vector<OutputSptr> outputs;
+    thread_local const SharedConsumer* outputs_consumer = nullptr;
+    thread_local uint64_t outputs_generation = 0;
+
+    const auto generation = consumer->m_Generation.load(std::memory_order_acquire);
+    if (outputs_consumer != consumer.get() || outputs_generation != generation)
+    {
+        std::lock_guard lock(consumer->m_Mutex);
+        outputs = consumer->m_Outputs;
+        outputs_consumer = consumer.get();
+        outputs_generation = consumer->m_Generation.load(std::memory_order_relaxed);
+    }
+
+    if (! consumer->ServeOutputs(outputs))
+    {
+        return LoggerThreadStatus::RUNNING;
+    }
+
+    auto& doorbell = *consumer->m_Doorbell;
+    const auto seen = doorbell.Arm();
+    if (consumer->ServeOutputs(outputs) && consumer->m_Generation.load(std::memory_order_acquire) == outputs_generation)
+    {
+        if (consumer->IsFinished())
+        {
+            doorbell.Disarm();
+            outputs.clear(); // releases outputs that the thread holds
+            return LoggerThreadStatus::FINISHED;
+        }
+        doorbell.Wait(seen, park_timeout);
+    }
+    doorbell.Disarm();
+
+    return LoggerThreadStatus::RUNNING;
+}
+
+} // namespace obps
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic> // std::atomic, std::atomic_flag
+#include <chrono> // std::chrono::milliseconds
+#include <functional> // std::function
+#include <memory> // std::shared_ptr
+#include <mutex> // std::mutex
+#include <vector> // std::vector
+
+#include "log_def.hpp"
+#include "doorbell.hpp"
+#include "thread_specs.hpp"
+
+namespace obps
+{
+
+class SharedConsumer;
+using SharedConsumerSptr = std::shared_ptr<SharedConsumer>;
+
+// Serves outputs of many logs with a fixed number of threads of a log pool,
+// instead of a logger thread per output.
+// Each thread goes over the outputs round-robin and writes batches that are ready,
+// once none of the outputs has messages it parks on a doorbell that is rung by writers of their queues.
+// An output is served by a single thread at a time.
+class SharedConsumer final
+{
+public:
+    // Serves an output once without waiting for messages, sets idle if there were none.
+    // Output is removed once it returns anything but RUNNING.
+    using ServeFunction = std::function<LoggerThreadStatus(bool& idle)>;
+
+    // parked thread checks the outputs at least this often, in case of a missed wake-up
+    static constexpr std::chrono::milliseconds park_timeout{100};
+
+    // creates consumer and starts its threads in the pool
+    static SharedConsumerSptr Create(LogPoolSptr pool, size_t threads, ThreadSpecsSptr thread_specs = nullptr);
+
+    void AddOutput(const LogQueueSptr& queue, ServeFunction serve);
+
+    // threads finish once all outputs have finished (their queues are shut down and drained)
+    void ShutDown();
+
+    SharedConsumer() : m_Doorbell(std::make_shared<Doorbell>()) {}
+    ~SharedConsumer() = default;
+
+    // Non-copyable
+    SharedConsumer(const SharedConsumer&) = delete;
+    SharedConsumer& operator=(const SharedConsumer&) = delete;
+
+    // Non-movable
+    SharedConsumer(SharedConsumer&&) = delete;
+    SharedConsumer& operator=(SharedConsumer&&) = delete;
+
+private:
+    struct Output
+    {
+        ServeFunction Serve;
+        std::atomic_flag Busy = ATOMIC_FLAG_INIT; // served by some thread
+    };
+    using OutputSptr = std::shared_ptr<Output>;
+
+    // thread function of the pool, serves all outputs once and parks if they are idle
+    static LoggerThreadStatus ConsumerThread(SharedConsumerSptr consumer);
+
+    // serves each output once, returns true if none of them had messages
+    bool ServeOutputs(std::vector<OutputSptr>& outputs);
+    void RemoveOutput(const OutputSptr& output);
+    bool IsFinished();
+
+    std::shared_ptr<Doorbell> m_Doorbell;
+    ThreadSpecsSptr           m_ThreadSpecs;
+    std::atomic<bool>         m_ShutDown = false;
+
+    std::mutex                m_Mutex;
+    std::vector<OutputSptr>   m_Outputs;     // guarded by m_Mutex
+    std::atomic<uint64_t>     m_Generation = 0; // changes with the outputs list
+};
+
+} // namespace obps
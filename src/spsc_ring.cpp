@@ -0,0 +1,108 @@
+#include "spsc_ring.hpp"
+
+#include <cstring> // std::memcpy
+
+namespace obps
+{
+
+SpscRing::SpscRing(const size_t capacity)
+    : m_Capacity(Align(capacity))
+    , m_Buffer(std::make_unique<char[]>(m_Capacity))
+    , m_Head(0)
+    , m_CachedTail(0)
+    , m_Tail(0)
+    , m_CachedHead(0)
+{}
+
+bool SpscRing::TryWrite(const char* const record, const size_t size, const uint64_t order) noexcept
+{
+    const size_t needed = Align(header_size + size);
+    uint64_t head = m_Head.load(std::memory_order_relaxed);
+    size_t position = head % m_Capacity;
+
+    // record that doesn't fit at the end wraps to the beginning, the rest of the buffer is skipped
+    if (m_Capacity - position < needed)
+    {
+        const size_t padding = m_Capacity - position;
+        if (! HasRoom(head, padding))
+        {
+            return false;
+        }
+
+        // marker is published on its own, so a record of the whole capacity fits once the consumer passes it;
+        // records are aligned, so there is always room for a marker at the end
+        std::memcpy(&m_Buffer[position], &wrap_marker, sizeof(wrap_marker));
+        head += padding;
+        m_Head.store(head, std::memory_order_release);
+        position = 0;
+    }
+
+    if (! HasRoom(head, needed))
+    {
+        return false;
+    }
+
+    const auto length = static_cast<uint32_t>(size);
+    std::memcpy(&m_Buffer[position], &length, sizeof(length));
+    std::memcpy(&m_Buffer[position + 2 * sizeof(uint32_t)], &order, sizeof(order));
+    std::memcpy(&m_Buffer[position + header_size], record, size);
+
+    m_Head.store(head + needed, std::memory_order_release);
+    return true;
+}
+
+bool SpscRing::Peek(const char*& record, size_t& size, uint64_t& order) noexcept
+{
+    uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+    if (tail == m_CachedHead)
+    {
+        m_CachedHead = m_Head.load(std::memory_order_acquire);
+        if (tail == m_CachedHead)
+        {
+            return false;
+        }
+    }
+
+    size_t position = tail % m_Capacity;
+    uint32_t length;
+    std::memcpy(&length, &m_Buffer[position], sizeof(length));
+    if (length == wrap_marker)
+    {
+        // marker may be published before the record that follows it
+        tail += m_Capacity - position;
+        m_Tail.store(tail, std::memory_order_release);
+        if (tail == m_CachedHead)
+        {
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            if (tail == m_CachedHead)
+            {
+                return false;
+            }
+        }
+        position = 0;
+        std::memcpy(&length, &m_Buffer[position], sizeof(length));
+    }
+
+    std::memcpy(&order, &m_Buffer[position + 2 * sizeof(uint32_t)], sizeof(order));
+    record = &m_Buffer[position + header_size];
+    size = length;
+    return true;
+}
+
+bool SpscRing::HasRoom(const uint64_t head, const size_t size) noexcept
+{
+    if (m_Capacity - (head - m_CachedTail) < size)
+    {
+        m_CachedTail = m_Tail.load(std::memory_order_acquire);
+        return m_Capacity - (head - m_CachedTail) >= size;
+    }
+    return true;
+}
+
+void SpscRing::Release(const size_t size) noexcept
+{
+    const uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+    m_Tail.store(tail + Align(header_size + size), std::memory_order_release);
+}
+
+} // namespace obps
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic> // std::atomic
+#include <cstdint> // uint32_t, uint64_t
+#include <memory> // std::unique_ptr
+
+namespace obps
+{
+
+// Lock-free single producer, single consumer ring buffer of variable length records.
+// Record layout: [uint32_t length][uint32_t padding][uint64_t order][bytes], aligned to record_alignment.
+// Order is an arbitrary key provided by the producer, that is used by the consumer to merge several rings.
+//
+// Positions are monotonic counters, producer and consumer own their positions
+// and keep cached copies of the other side's position on their own cache line.
+class SpscRing
+{
+public:
+    static constexpr size_t record_alignment = 8;
+    static constexpr size_t header_size = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+    // capacity: ring size in bytes, rounded up to record_alignment
+    explicit SpscRing(size_t capacity);
+    ~SpscRing() = default;
+
+    // Producer side: copies record into the ring, returns false if there is no room for it.
+    // Record must not be longer than GetMaxRecordSize().
+    bool TryWrite(const char* record, size_t size, uint64_t order) noexcept;
+
+    // Consumer side: gets the oldest record of the ring without releasing it, returns false if ring is empty.
+    bool Peek(const char*& record, size_t& size, uint64_t& order) noexcept;
+
+    // Consumer side: releases record that has been peeked.
+    void Release(size_t size) noexcept;
+
+    bool IsEmpty() const noexcept
+    {
+        return m_Tail.load(std::memory_order_relaxed) == m_Head.load(std::memory_order_acquire);
+    }
+
+    size_t GetMaxRecordSize() const noexcept
+    {
+        return m_Capacity - header_size;
+    }
+
+    // Non-copyable
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Non-movable
+    SpscRing(SpscRing&&) = delete;
+    SpscRing& operator=(SpscRing&&) = delete;
+
+private:
+    static constexpr size_t cache_line_size = 64;
+    static constexpr uint32_t wrap_marker = ~uint32_t{0};
+
+    static constexpr size_t Align(const size_t size) noexcept
+    {
+        return (size + record_alignment - 1) & ~(record_alignment - 1);
+    }
+
+    // producer side: checks free space, refreshing the cached tail if it seems too small
+    bool HasRoom(uint64_t head, size_t size) noexcept;
+
+    const size_t            m_Capacity;
+    std::unique_ptr<char[]> m_Buffer;
+
+    // producer's cache line
+    alignas(cache_line_size) std::atomic<uint64_t> m_Head;
+    uint64_t m_CachedTail;
+
+    // consumer's cache line
+    alignas(cache_line_size) std::atomic<uint64_t> m_Tail;
+    uint64_t m_CachedHead;
+};
+
+} // namespace obps
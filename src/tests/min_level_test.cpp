@@ -0,0 +1,44 @@
+// Built against a configuration header generated with OBPS_LOG_MIN_LEVEL=INFO (see CMakeLists.txt):
+//  calls of the levels after INFO are compiled out together with evaluation of their arguments.
+#include "ObpsLogConfig.hpp"
+#include "message_data.hpp"
+
+#include <iostream>
+
+// stands for the scope log, counts the calls that are compiled in
+struct CountingLog
+{
+    template <typename ...Args>
+    void Write(obps::LogLevel, bool, const Args& ...)
+    {
+        Writes++;
+    }
+
+    int Writes = 0;
+};
+
+#define _SCOPE_LOG_ID counting_log
+
+int evaluated = 0;
+
+int SideEffect()
+{
+    return ++evaluated;
+}
+
+int main()
+{
+    CountingLog counting_log;
+
+    INFO("kept ", SideEffect());
+    USER_LEVEL("compiled out ", SideEffect());
+    DEBUG("compiled out ", SideEffect());
+    DEBUG_SYNC("compiled out ", SideEffect());
+
+    if (counting_log.Writes != 1 || evaluated != 1)
+    {
+        std::cout << "Fail: " << counting_log.Writes << " writes, " << evaluated << " evaluations";
+        return 1;
+    }
+    std::cout << "Pass";
+}
@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+
+#include "flight_recorder.hpp"
+
+#include <string>
+#include <vector>
+
+TEST(TestFlightRecorder, EvictsOldestRecords)
+{
+    obps::FlightRecorder recorder(64, obps::LogLevel::INFO, obps::LogLevel::ERROR);
+    EXPECT_TRUE(recorder.Records(obps::LogLevel::DEBUG));
+    EXPECT_FALSE(recorder.Records(obps::LogLevel::INFO));
+    EXPECT_TRUE(recorder.Dumps(obps::LogLevel::ERROR));
+    EXPECT_FALSE(recorder.Dumps(obps::LogLevel::WARN));
+
+    std::vector<std::string> dumped;
+    const auto dump = [&recorder, &dumped]{
+        dumped.clear();
+        recorder.DumpTo([&dumped](const char* data, size_t size){
+            dumped.emplace_back(data, size);
+        });
+    };
+
+    // two records of 32 bytes fit
+    for (const char c : {'a', 'b', 'c'})
+    {
+        const std::string record(20, c);
+        recorder.Record(record.data(), record.size());
+    }
+    dump();
+    EXPECT_EQ(dumped, (std::vector<std::string>{std::string(20, 'b'), std::string(20, 'c')}));
+
+    // third record of 24 bytes wraps, evicting the first one
+    for (const char c : {'x', 'y', 'z'})
+    {
+        const std::string record(10, c);
+        recorder.Record(record.data(), record.size());
+    }
+    const std::string too_long(100, 'l');
+    recorder.Record(too_long.data(), too_long.size()); // larger than the recorder, evicted at once
+    dump();
+    EXPECT_EQ(dumped, (std::vector<std::string>{std::string(10, 'y'), std::string(10, 'z')}));
+
+    dump();
+    EXPECT_TRUE(dumped.empty());
+}
@@ -33,7 +33,7 @@ protected:
 
     void SetUp() override
     {
-        std::this_thread::sleep_for(100ms);
+        OBPS_LOG_FLUSH(); // logs of the previous tests are done with the streams
         out.str("");
         out.clear();
         err.str("");
@@ -65,8 +65,7 @@ TEST_F(TestGlobalLog, TestAPI)
     G_UNMUTE(LogLevel::WARN); // nothing will happen, it's fine to pass levels that not being muted
     G_UNMUTE(LogLevel::INFO, LogLevel::ERROR); // will only unmute error
 
-    // make sure that thread completed work
-    std::this_thread::sleep_for(100ms);
+    G_FLUSH();
 
     message.assign((std::istreambuf_iterator<char>(err)), std::istreambuf_iterator<char>());
     EXPECT_THAT(message, MatchesRegex("^.*ERROR Alert! 90f\n$"));
@@ -95,7 +94,7 @@ TEST_F(TestGlobalLog, TestFromThreads)
             threads.emplace_back(thread_func);
         }
     }
-    std::this_thread::sleep_for(100ms); // make sure that thread completed work
+    G_FLUSH();
 
     message.assign((std::istreambuf_iterator<char>(err)), std::istreambuf_iterator<char>());
     
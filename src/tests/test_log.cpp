@@ -3,9 +3,18 @@
 #include "gmock/gmock.h"
 
 using ::testing::MatchesRegex;
+using ::testing::HasSubstr;
+using ::testing::EndsWith;
+using ::testing::Not;
 
 #include "obps_log_public.hpp"
+#include "binary_format.hpp"
 
+#include <algorithm>
+#include <array>
+#include <csignal>
+#include <cstdlib>
+#include <future>
 #include <thread>
 #include <sstream>
 #include <iostream>
@@ -60,7 +69,7 @@ TEST_F(TestLog, TestSingleError)
     int num = 42;
     ERROR("num == ", num, " is a prohibitted value!");
 
-    std::this_thread::sleep_for(10ms); // make sure that thread completed work
+    FLUSH();
      
     message.assign((std::istreambuf_iterator<char>(out)), std::istreambuf_iterator<char>());
 
@@ -77,7 +86,7 @@ TEST_F(TestLog, TestLevels)
     WARN("some warning message!");  // ok
     ERROR("some error message!");   // ok
 
-    std::this_thread::sleep_for(10ms); // make sure that thread completed work
+    FLUSH();
      
     message.assign((std::istreambuf_iterator<char>(out)), std::istreambuf_iterator<char>());
 
@@ -97,7 +106,7 @@ TEST_F(TestLog, TestMultipleTargets)
     WARN("some warning message!");  // out & err
     ERROR("some error message!");   // out & err
 
-    std::this_thread::sleep_for(10ms); // make sure that thread completed work
+    FLUSH();
      
     message.assign(std::istreambuf_iterator<char>(out), std::istreambuf_iterator<char>());
 
@@ -108,6 +117,55 @@ TEST_F(TestLog, TestMultipleTargets)
     EXPECT_THAT(message, MatchesRegex(".*WARN some warning message!\n.*ERROR some error message!\n"));
 }
 
+TEST_F(TestLog, TestIsolatedTarget)
+{
+    SCOPE_LOG({LogLevel::WARN, out}, 
+              {LogLevel::INFO, err, obps::LogRegistry::default_queue_size, obps::LogRegistry::GenerateQueueUid(), 
+                obps::Log::LogSpecs::OutputModifier::ISOLATED}); // only INFO messages
+
+    DEBUG("some debug message!");   // none
+    INFO("some info message!");     // err
+    WARN("some warning message!");  // out
+    ERROR("some error message!");   // out
+
+    FLUSH();
+     
+    message.assign(std::istreambuf_iterator<char>(out), std::istreambuf_iterator<char>());
+
+    EXPECT_THAT(message, MatchesRegex(".*WARN some warning message!\n.*ERROR some error message!\n"));
+
+    message.assign((std::istreambuf_iterator<char>(err)), std::istreambuf_iterator<char>());
+
+    EXPECT_THAT(message, MatchesRegex(".*INFO some info message!\n"));
+}
+
+TEST_F(TestLog, TestSharedConsumer)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+
+    // more outputs than threads of the shared consumer, 
+    //  each output has its own stream, as outputs may be served by different threads at once
+    static std::array<std::stringstream, 8> streams;
+    std::vector<std::unique_ptr<obps::Log>> logs;
+    for (int i = 0; i < 8; i++)
+    {
+        logs.push_back(std::make_unique<obps::Log>(obps::Log::LogSpecs{
+            OutputSpecs(LogLevel::INFO, streams[i]).SetSharedConsumer()
+        }));
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        logs[i]->Write(LogLevel::INFO, false, "message of log ", i);
+    }
+
+    OBPS_LOG_FLUSH(); // logs of the test are written by the shared consumer
+
+    for (int i = 0; i < 8; i++)
+    {
+        EXPECT_THAT(streams[i].str(), MatchesRegex(".*INFO message of log " + std::to_string(i) + "\n"));
+    }
+}
 
 TEST_F(TestLog, TestFileTarget)
 {
@@ -120,7 +178,7 @@ TEST_F(TestLog, TestFileTarget)
 
     DEBUG_SYNC("some debug message!");   // out
 
-    std::this_thread::sleep_for(10ms); // make sure that thread completed work
+    FLUSH();
      
     std::fstream log_file_in(expected_log_path);
     
@@ -139,7 +197,7 @@ TEST_F(TestLog, TestMuteUnmute)
     ERROR("trying to send an error to a log");
     DEBUG("trying to send a debug to a log");
 
-    std::this_thread::sleep_for(10ms); // make sure that thread completed work
+    FLUSH();
 
     message.assign((std::istreambuf_iterator<char>(out)), std::istreambuf_iterator<char>());
     EXPECT_THAT(message, MatchesRegex("^$")) << "Expected nothing to be printed!";
@@ -149,8 +207,546 @@ TEST_F(TestLog, TestMuteUnmute)
     ERROR("Another try to send an error to a log");
     DEBUG("Another try to send a debug to a log");
 
-    std::this_thread::sleep_for(10ms); // make sure that thread completed work
+    FLUSH();
 
     message.assign((std::istreambuf_iterator<char>(out)), std::istreambuf_iterator<char>());
     EXPECT_THAT(message, MatchesRegex(".*ERROR .*\n")) << "Expected to print only Error message!";
-}
\ No newline at end of file
+}
+
+TEST_F(TestLog, TestMuteFromAnotherThread)
+{
+    SCOPE_LOG({LogLevel::INFO , out});
+
+    std::atomic<bool> done = false;
+    std::thread admin([&done]{
+        while (! done)
+        {
+            MUTE(LogLevel::WARN);
+            UNMUTE(LogLevel::WARN);
+        }
+    });
+
+    for (int i = 0; i < 1000; i++)
+    {
+        WARN("warning that may be dropped ", i);
+    }
+    done = true;
+    admin.join();
+
+    MUTE(LogLevel::ERROR, LogLevel::WARN);
+    WARN("muted warning");
+    ERROR("muted error");
+    INFO("last message");
+    DEBUG("debug is not accepted by the output");
+
+    FLUSH();
+
+    message.assign((std::istreambuf_iterator<char>(out)), std::istreambuf_iterator<char>());
+    EXPECT_THAT(message, Not(HasSubstr("muted")));
+    EXPECT_THAT(message, Not(HasSubstr("debug")));
+    EXPECT_THAT(message, EndsWith("INFO last message\n"));
+}
+
+struct Point 
+{
+    int x, y;
+};
+
+std::ostream& operator<<(std::ostream& out, const Point& p)
+{
+    return out << "(" << p.x << ", " << p.y << ")";
+}
+
+template <>
+struct std::formatter<Point> : std::formatter<std::string_view>
+{
+    auto format(const Point& p, std::format_context& ctx) const
+    {
+        return std::format_to(ctx.out(), "({}, {})", p.x, p.y);
+    }
+};
+
+TEST_F(TestLog, TestArgumentTypes)
+{
+    SCOPE_LOG({LogLevel::INFO, out});
+
+    const std::string str = "string";
+    INFO(true, ' ', -7, ' ', 42u, ' ', 1.5, ' ', str, ' ', std::string_view("view"));
+    INFO(std::hex, 255, " ", std::boolalpha, true); 
+    INFO(255, " ", true); // stream state doesn't leak into next message
+    INFO("point ", Point{1, 2}); // user type is formatted on the caller side
+
+    FLUSH();
+
+    message.assign((std::istreambuf_iterator<char>(out)), std::istreambuf_iterator<char>());
+
+    EXPECT_THAT(message, MatchesRegex(
+        ".*INFO 1 -7 42 1.5 string view\n"
+        ".*INFO ff true\n"
+        ".*INFO 255 1\n"
+        ".*INFO point \\(1, 2\\)\n"));
+}
+
+
+TEST_F(TestLog, TestLongMessage)
+{
+    SCOPE_LOG({LogLevel::INFO, out});
+
+    const std::string long_text(4 * MAX_MSG_SIZE, 'x');
+    INFO("long ", long_text, " end");
+    INFO("short");
+
+    FLUSH();
+
+    message.assign((std::istreambuf_iterator<char>(out)), std::istreambuf_iterator<char>());
+
+    EXPECT_NE(message.find("INFO long " + long_text + " end\n"), std::string::npos) << "Expected message not to be truncated!";
+    EXPECT_THAT(message, MatchesRegex(".*INFO short\n$"));
+}
+
+
+TEST_F(TestLog, TestPerThreadQueues)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+    SCOPE_LOG(OutputSpecs(LogLevel::INFO, out).SetQueueMode(obps::LogQueue::Mode::PER_THREAD));
+
+    const size_t threads_count = 8;
+    {
+        std::vector<std::jthread> threads;
+        for (size_t i = 0; i < threads_count; ++i)
+        {
+            threads.emplace_back([](){ INFO("from thread"); });
+        }
+    }
+
+    FLUSH();
+
+    message.assign((std::istreambuf_iterator<char>(out)), std::istreambuf_iterator<char>());
+
+    std::string expected;
+    for (size_t i = 0; i < threads_count; ++i)
+    {
+        expected += ".*INFO from thread\n";
+    }
+    EXPECT_THAT(message, MatchesRegex(expected));
+}
+
+
+TEST_F(TestLog, TestFlushBarrier)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+
+    // queues of a few messages, so writers and barriers wait for room
+    obps::Log log(obps::Log::LogSpecs{OutputSpecs(LogLevel::INFO, out, 2), 
+        OutputSpecs(LogLevel::INFO, err, 2).SetQueueMode(obps::LogQueue::Mode::PER_THREAD)});
+
+    const size_t threads_count = 4;
+    const size_t messages_count = 100;
+    {
+        std::vector<std::jthread> threads;
+        for (size_t i = 0; i < threads_count; ++i)
+        {
+            threads.emplace_back([&log](){
+                for (size_t j = 0; j < messages_count; ++j)
+                {
+                    log.Write(LogLevel::INFO, false, "message ", j);
+                }
+            });
+        }
+    }
+
+    auto flushed = log.FlushAsync(true);
+    ASSERT_EQ(flushed.wait_for(1s), std::future_status::ready);
+
+    const auto lines = [](const std::stringstream& stream){
+        const auto text = stream.str();
+        return std::count(text.begin(), text.end(), '\n');
+    };
+    EXPECT_EQ(lines(out), threads_count * messages_count);
+    EXPECT_EQ(lines(err), threads_count * messages_count);
+}
+
+TEST_F(TestLog, TestFdFileTarget)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+    using FileSpecs = obps::Log::LogSpecs::FileSpecs;
+
+    fs::create_directory(logdir);  // prepare directory on user side
+    fs::remove(expected_log_path); // clean test
+
+    // small aligned buffer makes the sink write in parts
+    SCOPE_LOG(OutputSpecs(LogLevel::DEBUG, logdir / logname)
+        .SetFileSpecs({FileSpecs::Sink::FD, 64, 16}));
+
+    ASSERT_TRUE(fs::exists(expected_log_path));
+
+    DEBUG("first debug message!");
+    DEBUG("second debug message!");
+    DEBUG_SYNC("third debug message!");
+
+    FLUSH();
+     
+    std::fstream log_file_in(expected_log_path);
+    
+    message.assign((std::istreambuf_iterator<char>(log_file_in)), std::istreambuf_iterator<char>());
+
+    EXPECT_THAT(message, MatchesRegex(
+        ".*DEBUG first debug message!\n"
+        ".*DEBUG second debug message!\n"
+        ".*DEBUG third debug message!\n"));
+}
+
+TEST_F(TestLog, TestMmapFileTarget)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+    using FileSpecs = obps::Log::LogSpecs::FileSpecs;
+
+    fs::create_directory(logdir);  // prepare directory on user side
+    fs::remove(expected_log_path); // clean test
+
+    // chunk is rounded up to a single page, so the file is remapped while writing
+    SCOPE_LOG(OutputSpecs(LogLevel::DEBUG, logdir / logname)
+        .SetFileSpecs({.SinkType = FileSpecs::Sink::MMAP, .ChunkSize = 1}));
+
+    ASSERT_TRUE(fs::exists(expected_log_path));
+
+    const std::string filler(200, 'x');
+    for (int i = 0; i < 32; i++)
+    {
+        DEBUG(i, filler);
+    }
+    DEBUG_SYNC("last debug message!");
+
+    FLUSH();
+     
+    std::fstream log_file_in(expected_log_path);
+    
+    message.assign((std::istreambuf_iterator<char>(log_file_in)), std::istreambuf_iterator<char>());
+    // file is cut to the written size only on close, the rest of the chunk is zeroed
+    message.erase(message.find_last_not_of('\0') + 1);
+
+    EXPECT_THAT(message, MatchesRegex(
+        ".*DEBUG 0x{200}\n"
+        "(.*\n){30}"
+        ".*DEBUG 31x{200}\n"
+        ".*DEBUG last debug message!\n"));
+}
+
+TEST_F(TestLog, TestUringFileTarget)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+    using FileSpecs = obps::Log::LogSpecs::FileSpecs;
+
+    fs::create_directory(logdir);  // prepare directory on user side
+    fs::remove(expected_log_path); // clean test
+
+    // buffers are shorter than the batch, so several writes are in flight and complete out of order
+    SCOPE_LOG(OutputSpecs(LogLevel::DEBUG, logdir / logname)
+        .SetFileSpecs({.SinkType = FileSpecs::Sink::URING, .BufferSize = 512, .Buffers = 3}));
+
+    ASSERT_TRUE(fs::exists(expected_log_path));
+
+    const std::string filler(200, 'x');
+    for (int i = 0; i < 32; i++)
+    {
+        DEBUG(i, filler);
+    }
+    DEBUG_SYNC("last debug message!");
+
+    FLUSH();
+     
+    std::fstream log_file_in(expected_log_path);
+    
+    message.assign((std::istreambuf_iterator<char>(log_file_in)), std::istreambuf_iterator<char>());
+
+    EXPECT_THAT(message, MatchesRegex(
+        ".*DEBUG 0x{200}\n"
+        "(.*\n){30}"
+        ".*DEBUG 31x{200}\n"
+        ".*DEBUG last debug message!\n"));
+}
+
+TEST_F(TestLog, TestRotationBySize)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+    using FileSpecs = obps::Log::LogSpecs::FileSpecs;
+
+    const std::string prefix = "rotated";
+    const auto rotated_files = [&]{
+        std::vector<fs::path> files;
+        for (const auto& entry : fs::directory_iterator(logdir))
+        {
+            if (entry.path().filename().string().starts_with(prefix + "-"))
+            {
+                files.push_back(entry.path());
+            }
+        }
+        return files;
+    };
+
+    fs::create_directory(logdir);
+    for (const auto& file : rotated_files())
+    {
+        fs::remove(file);
+    }
+
+    // files of other logs whose names start with the prefix are left by retention
+    const auto other_log = logdir / (prefix + "-2-2024-01-01.log");
+    const auto other_dated = logdir / (prefix + "-2024-01-01-extra.log");
+    std::ofstream(other_log) << "other log\n";
+    std::ofstream(other_dated) << "other log\n";
+
+    {
+        // a message per batch, about 4 of them fit into a file
+        SCOPE_LOG(OutputSpecs(LogLevel::DEBUG, logdir / prefix)
+            .SetBatching(1)
+            .SetFileSpecs({.SinkType = FileSpecs::Sink::FD})
+            .SetRotation({.MaxSize = 1024, .KeepFiles = 3}));
+
+        const std::string filler(200, 'x');
+        for (int i = 0; i < 40; i++)
+        {
+            DEBUG(i, filler);
+            std::this_thread::sleep_for(1ms);
+        }
+        DEBUG_SYNC("last debug message!");
+
+        FLUSH(); // retired files are closed and the old ones removed
+    }
+
+    EXPECT_TRUE(fs::remove(other_log));
+    EXPECT_TRUE(fs::remove(other_dated));
+
+    const auto files = rotated_files();
+    ASSERT_EQ(files.size(), 3);
+
+    // only the newest messages remain, none of them split between files
+    std::string kept;
+    for (const auto& file : files)
+    {
+        EXPECT_LE(fs::file_size(file), 1024);
+        std::ifstream in(file);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        EXPECT_THAT(content, EndsWith("\n"));
+        kept += content;
+    }
+    EXPECT_THAT(kept, Not(HasSubstr("DEBUG 0x")));
+    EXPECT_THAT(kept, HasSubstr("DEBUG 39x"));
+    EXPECT_THAT(kept, HasSubstr("DEBUG last debug message!"));
+}
+
+TEST_F(TestLog, TestRotationBinaryFormats)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+
+    const std::string prefix = "rotated_bin";
+    const auto rotated_files = [&]{
+        std::vector<fs::path> files;
+        for (const auto& entry : fs::directory_iterator(logdir))
+        {
+            if (entry.path().filename().string().starts_with(prefix + "-"))
+            {
+                files.push_back(entry.path());
+            }
+        }
+        return files;
+    };
+
+    fs::create_directory(logdir);
+    for (const auto& file : rotated_files())
+    {
+        fs::remove(file);
+    }
+
+    {
+        SCOPE_LOG(OutputSpecs(LogLevel::INFO, logdir / prefix, obps::LogRegistry::default_queue_size, 
+                obps::LogRegistry::GenerateQueueUid(), obps::Log::LogSpecs::OutputModifier::NONE, &obps::Log::BINARY)
+            .SetBatching(1)
+            .SetRotation({.MaxSize = 512}));
+
+        for (int i = 0; i < 40; i++)
+        {
+            INFO_FMT("value {} of the formatted call site", i);
+        }
+        FLUSH();
+    }
+
+    const auto files = rotated_files();
+    ASSERT_GE(files.size(), 3);
+
+    // every file describes the call site again, headers are counted in the max size
+    size_t decoded = 0;
+    for (const auto& file : files)
+    {
+        EXPECT_LE(fs::file_size(file), 512);
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream text;
+        decoded += obps::DecodeBinaryLog(in, text, &obps::Log::default_format);
+        EXPECT_THAT(text.str(), MatchesRegex("(.*INFO value [0-9]+ of the formatted call site\n)+"));
+    }
+    EXPECT_EQ(decoded, 40);
+}
+
+TEST_F(TestLog, TestOutputStats)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+
+    SCOPE_LOG(OutputSpecs(LogLevel::DEBUG, out, obps::LogRegistry::default_queue_size, "stats_queue"));
+
+    for (int i = 0; i < 3; i++)
+    {
+        DEBUG("message ", i);
+    }
+
+    FLUSH();
+
+    const auto stats = obps::LogRegistry::GetLogRegistry()->GetOutputStats();
+    const auto output = std::find_if(stats.begin(), stats.end(), [](const auto& output){
+        return output.QueueId == "stats_queue";
+    });
+    ASSERT_NE(output, stats.end());
+
+    EXPECT_EQ(output->Queue.Enqueued, 3);
+    EXPECT_EQ(output->Queue.Depth, 0);
+    EXPECT_EQ(output->Queue.BatchSizes.Sum, 3);
+    EXPECT_EQ(output->Sink.BytesWritten, out.str().size());
+    EXPECT_GE(output->Sink.WriteNanos.Count, 1);
+}
+
+TEST_F(TestLog, TestBinaryOutput)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+
+    SCOPE_LOG(OutputSpecs(LogLevel::DEBUG, out, obps::LogRegistry::default_queue_size, 
+        obps::LogRegistry::GenerateQueueUid(), obps::Log::LogSpecs::OutputModifier::NONE, &obps::Log::BINARY));
+
+    DEBUG("first debug message: ", 42, std::hex, 255);
+    DEBUG_SYNC("second debug message!");
+
+    FLUSH();
+
+    std::stringstream text;
+    EXPECT_EQ(obps::DecodeBinaryLog(out, text, &obps::Log::default_format), 2);
+    EXPECT_THAT(text.str(), MatchesRegex(
+        "[-0-9]+ [:0-9]+\\.[0-9]{6} \\[[0-9]+\\] DEBUG first debug message: 42ff\n"
+        ".*DEBUG second debug message!\n"));
+
+    std::stringstream not_binary("2024-01-01 00:00:00 [1] DEBUG text message\n");
+    EXPECT_THROW(obps::DecodeBinaryLog(not_binary, text, &obps::Log::default_format), std::runtime_error);
+}
+
+TEST_F(TestLog, TestFormatMessages)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+
+    SCOPE_LOG(OutputSpecs(LogLevel::INFO, out), 
+        OutputSpecs(LogLevel::INFO, err, obps::LogRegistry::default_queue_size, 
+            obps::LogRegistry::GenerateQueueUid(), obps::Log::LogSpecs::OutputModifier::NONE, &obps::Log::BINARY));
+
+    for (int i = 0; i < 2; i++)
+    {
+        INFO_FMT("{} + {:>4} = {:.2f} {}", i, std::string("two"), 2.5, true);
+    }
+    INFO_FMT("point {}", Point{1, 2}); // user type is formatted on the caller side
+    INFO_FMT_SYNC("no arguments");
+
+    FLUSH();
+
+    const auto expected = 
+        ".*INFO 0 \\+  two = 2.50 true\n"
+        ".*INFO 1 \\+  two = 2.50 true\n"
+        ".*INFO point \\(1, 2\\)\n"
+        ".*INFO no arguments\n";
+    EXPECT_THAT(out.str(), MatchesRegex(expected));
+
+    std::stringstream text;
+    EXPECT_EQ(obps::DecodeBinaryLog(err, text, &obps::Log::default_format), 4);
+    EXPECT_THAT(text.str(), MatchesRegex(expected));
+}
+
+TEST_F(TestLog, TestFormatDynamicSpecs)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+
+    SCOPE_LOG(OutputSpecs(LogLevel::INFO, out), 
+        OutputSpecs(LogLevel::INFO, err, obps::LogRegistry::default_queue_size, 
+            obps::LogRegistry::GenerateQueueUid(), obps::Log::LogSpecs::OutputModifier::NONE, &obps::Log::BINARY));
+
+    // width and precision are taken from the arguments, with automatic and manual numbering
+    INFO_FMT("[{:>{}}] [{:.{}f}]", "ab", 4, 3.14159, 2);
+    INFO_FMT("[{0:>{1}}] [{2:{1}.{3}f}]", "ab", 6, 3.14159, 1);
+
+    FLUSH();
+
+    const auto expected = 
+        ".*INFO \\[  ab\\] \\[3.14\\]\n"
+        ".*INFO \\[    ab\\] \\[   3.1\\]\n";
+    EXPECT_THAT(out.str(), MatchesRegex(expected));
+
+    std::stringstream text;
+    EXPECT_EQ(obps::DecodeBinaryLog(err, text, &obps::Log::default_format), 2);
+    EXPECT_THAT(text.str(), MatchesRegex(expected));
+}
+
+TEST_F(TestLog, TestFlightRecorder)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+
+    SCOPE_LOG(OutputSpecs(LogLevel::DEBUG, out)
+        .SetRecorder({.WriteLevel = LogLevel::INFO, .DumpLevel = LogLevel::ERROR}));
+
+    DEBUG("first debug");
+    INFO("info");
+    DEBUG_FMT("second {}", "debug");
+    FLUSH();
+    EXPECT_THAT(out.str(), MatchesRegex(".*INFO info\n"));
+
+    // error writes the recorded messages before itself
+    ERROR("error");
+    DEBUG("third debug");
+    FLUSH();
+    EXPECT_THAT(out.str(), MatchesRegex(
+        ".*INFO info\n"
+        ".*DEBUG first debug\n"
+        ".*DEBUG second debug\n"
+        ".*ERROR error\n"));
+
+    DUMP();
+    EXPECT_THAT(out.str(), EndsWith("DEBUG third debug\n"));
+}
+
+#if defined(LINUX)
+TEST_F(TestLog, TestCrashDrain)
+{
+    using OutputSpecs = obps::Log::LogSpecs::OutputSpecs;
+    using FileSpecs = obps::Log::LogSpecs::FileSpecs;
+
+    fs::create_directory(logdir);  // prepare directory on user side
+    fs::remove(expected_log_path); // clean test
+
+    // child aborts with messages still in the queue and in the file buffer
+    const auto crash = [this] {
+        SCOPE_LOG(OutputSpecs(LogLevel::DEBUG, logdir / logname)
+            .SetFileSpecs({.SinkType = FileSpecs::Sink::FD}));
+        obps::LogRegistry::InstallCrashHandler(); // covers outputs that exist already
+
+        for (int i = 0; i < 100; i++)
+        {
+            DEBUG("message ", i, ' ', std::hex, 255, ' ', 1.5, ' ', true);
+        }
+        ERROR_FMT("{} of {:#x} = {:.2f} {}", "last", 255, 2.5, true);
+        std::abort();
+    };
+    GTEST_FLAG_SET(death_test_style, "threadsafe");
+    EXPECT_EXIT(crash(), ::testing::KilledBySignal(SIGABRT), "");
+
+    std::ifstream log_file_in(expected_log_path);
+    message.assign((std::istreambuf_iterator<char>(log_file_in)), std::istreambuf_iterator<char>());
+
+    EXPECT_EQ(std::count(message.begin(), message.end(), '\n'), 101);
+    EXPECT_THAT(message, MatchesRegex(
+        "[-0-9]+ [:0-9]+\\.[0-9]{6} \\[[0-9]+\\] DEBUG message 0 ff 1.5 1\n"
+        ".*DEBUG message 99 ff 1.5 1\n"
+        ".*ERROR last of 0xff = 2.50 true\n"));
+}
+#endif // LINUX
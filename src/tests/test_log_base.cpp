@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+
+#include "log_base.hpp"
+
+TEST(TestTimestampCache, MatchesStrftime)
+{
+    obps::TimestampCache cache;
+
+    const std::time_t start = obps::get_timestamp();
+    // same second, next seconds, next minutes, a jump back and forward by days
+    for (const std::time_t stamp : {start, start, start + 1, start + 59, start + 61, start + 3600, 
+        start - 86400, start - 86399, start + 86400 * 200, start})
+    {
+        EXPECT_EQ(cache.Format(stamp), obps::get_time_string("%F %T", stamp));
+    }
+
+    for (std::time_t stamp = start; stamp < start + 600; stamp += 7)
+    {
+        EXPECT_EQ(cache.Format(stamp), obps::get_time_string("%F %T", stamp));
+    }
+}
+
+TEST(TestTimestampCache, FractionOfSecond)
+{
+    using namespace std::chrono_literals;
+    obps::TimestampCache cache;
+
+    const auto seconds = obps::get_timestamp();
+    const auto stamp = obps::TimeStamp(std::chrono::seconds(seconds)) + 123456789ns;
+    const auto date_time = obps::get_time_string("%F %T", seconds);
+
+    EXPECT_EQ(cache.Format(stamp, 0), date_time);
+    EXPECT_EQ(cache.Format(stamp, 3), date_time + ".123");
+    EXPECT_EQ(cache.Format(stamp, 6), date_time + ".123456");
+    EXPECT_EQ(cache.Format(stamp + 1ns, 9), date_time + ".123456790");
+}
+
+TEST(TestLogClock, ClockSources)
+{
+    using namespace std::chrono_literals;
+
+    for (const auto source : {obps::ClockSource::SYSTEM, obps::ClockSource::STEADY, obps::ClockSource::TSC})
+    {
+        obps::LogClock::Init(source);
+
+        const auto system = std::chrono::system_clock::now();
+        auto previous = obps::LogClock::Now(source);
+        EXPECT_LT(std::chrono::abs(previous - system), 10ms);
+
+        if (source == obps::ClockSource::SYSTEM)
+        {
+            continue;
+        }
+
+        for (int i = 0; i < 100000; i++)
+        {
+            const auto now = obps::LogClock::Now(source);
+            ASSERT_GE(now, previous);
+            previous = now;
+        }
+    }
+}
+
+#if defined(LINUX)
+#include <pthread.h> // pthread_getname_np
+#include <thread> // std::thread
+
+TEST(TestThreadSpecs, NameAndAffinity)
+{
+    std::thread([]{
+        cpu_set_t allowed;
+        ASSERT_EQ(::pthread_getaffinity_np(::pthread_self(), sizeof(allowed), &allowed), 0);
+        int cpu = 0;
+        while (! CPU_ISSET(cpu, &allowed))
+        {
+            cpu++;
+        }
+
+        obps::ThreadSpecs specs;
+        specs.Cpus = {cpu};
+        specs.Name = "obps-log-writer-thread";
+        EXPECT_TRUE(obps::ApplyThreadSpecs(specs));
+
+        char name[16];
+        ASSERT_EQ(::pthread_getname_np(::pthread_self(), name, sizeof(name)), 0);
+        EXPECT_STREQ(name, "obps-log-writer");
+
+        cpu_set_t cpus;
+        ASSERT_EQ(::pthread_getaffinity_np(::pthread_self(), sizeof(cpus), &cpus), 0);
+        EXPECT_EQ(CPU_COUNT(&cpus), 1);
+        EXPECT_TRUE(CPU_ISSET(cpu, &cpus));
+    }).join();
+}
+#endif
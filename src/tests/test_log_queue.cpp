@@ -0,0 +1,348 @@
+#include "gtest/gtest.h"
+
+#include "log_queue.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <chrono>
+using namespace std::chrono_literals;
+
+using obps::LogQueue;
+
+class TestLogQueue : public ::testing::Test
+{
+protected:
+    // reads single record into a string
+    static std::string Read(LogQueue& queue)
+    {
+        std::string record;
+        auto status = queue.ReadTo([&record](const char* data, size_t size){
+            record.assign(data, size);
+        });
+        EXPECT_EQ(status, LogQueue::OperationStatus::SUCCESS);
+        return record;
+    }
+
+    static void Write(LogQueue& queue, const std::string& record)
+    {
+        EXPECT_EQ(queue.Write(record.data(), record.size()), LogQueue::OperationStatus::SUCCESS);
+    }
+};
+
+
+TEST_F(TestLogQueue, TestVariableLengthRecords)
+{
+    LogQueue queue(2);
+
+    const std::string long_record(LogQueue::slot_size, 'l');
+    Write(queue, "a");
+    Write(queue, long_record);
+    Write(queue, "");
+
+    EXPECT_EQ(Read(queue), "a");
+    EXPECT_EQ(Read(queue), long_record);
+    EXPECT_EQ(Read(queue), "");
+}
+
+
+TEST_F(TestLogQueue, TestWrapAround)
+{
+    LogQueue queue(1);
+
+    // records of different length move the write position through the whole buffer
+    for (size_t i = 0; i < 10 * LogQueue::slot_size; i += 7)
+    {
+        const std::string record(i % (LogQueue::slot_size / 2), 'a' + i % 26);
+        Write(queue, record);
+        EXPECT_EQ(Read(queue), record);
+    }
+}
+
+
+TEST_F(TestLogQueue, TestTruncation)
+{
+    LogQueue queue(1);
+
+    const std::string huge_record(2 * queue.GetMaxRecordSize(), 'h');
+    Write(queue, huge_record);
+
+    EXPECT_EQ(Read(queue), huge_record.substr(0, queue.GetMaxRecordSize()));
+}
+
+
+TEST_F(TestLogQueue, TestShutdownDrainsQueue)
+{
+    LogQueue queue(4);
+
+    Write(queue, "first");
+    Write(queue, "second");
+    queue.ShutDown();
+
+    EXPECT_EQ(queue.Write("third", 5), LogQueue::OperationStatus::SHUTDOWN);
+    EXPECT_EQ(Read(queue), "first");
+    EXPECT_EQ(Read(queue), "second");
+    EXPECT_EQ(queue.ReadTo([](const char*, size_t){}), LogQueue::OperationStatus::SHUTDOWN);
+}
+
+
+TEST_F(TestLogQueue, TestBlockingWriters)
+{
+    LogQueue queue(1);
+
+    const size_t writers_count = 4, records_count = 100;
+    std::vector<std::jthread> writers;
+    for (size_t i = 0; i < writers_count; ++i)
+    {
+        writers.emplace_back([&queue]{
+            for (size_t j = 0; j < records_count; ++j)
+            {
+                Write(queue, std::string(j % LogQueue::slot_size, 'w'));
+            }
+        });
+    }
+
+    for (size_t i = 0; i < writers_count * records_count; ++i)
+    {
+        EXPECT_EQ(Read(queue).find_first_not_of('w'), std::string::npos);
+    }
+}
+
+
+TEST_F(TestLogQueue, TestReadBatch)
+{
+    LogQueue queue(4);
+
+    for (auto record : {"1", "2", "3", "4", "5"})
+    {
+        Write(queue, record);
+    }
+
+    std::string batch;
+    auto reader = [&batch](const char* data, size_t size){ batch.append(data, size); };
+
+    EXPECT_EQ(queue.ReadBatchTo(reader, 3, 0us), LogQueue::OperationStatus::SUCCESS);
+    EXPECT_EQ(batch, "123");
+
+    batch.clear();
+    EXPECT_EQ(queue.ReadBatchTo(reader, 3, 0us), LogQueue::OperationStatus::SUCCESS);
+    EXPECT_EQ(batch, "45") << "Expected to take only available records!";
+
+    // waits for records that arrive within the latency
+    batch.clear();
+    Write(queue, "6");
+    std::jthread writer([&queue]{
+        std::this_thread::sleep_for(5ms);
+        Write(queue, "7");
+    });
+    EXPECT_EQ(queue.ReadBatchTo(reader, 2, 10s), LogQueue::OperationStatus::SUCCESS);
+    EXPECT_EQ(batch, "67");
+
+    queue.ShutDown();
+    EXPECT_EQ(queue.ReadBatchTo(reader, 3, 0us), LogQueue::OperationStatus::SHUTDOWN);
+}
+
+
+TEST_F(TestLogQueue, TestPerThreadMerge)
+{
+    LogQueue queue(4, LogQueue::Mode::PER_THREAD);
+
+    // each thread gets its own ring, reader merges them by order key
+    std::jthread([&queue]{
+        for (uint64_t order : {1, 3, 5})
+        {
+            auto record = std::to_string(order);
+            queue.Write(record.data(), record.size(), order);
+        }
+    }).join();
+
+    std::jthread([&queue]{
+        for (uint64_t order : {2, 4, 6})
+        {
+            auto record = std::to_string(order);
+            queue.Write(record.data(), record.size(), order);
+        }
+    }).join();
+
+    for (auto expected : {"1", "2", "3", "4", "5", "6"})
+    {
+        EXPECT_EQ(Read(queue), expected);
+    }
+}
+
+
+TEST_F(TestLogQueue, TestPerThreadWriters)
+{
+    LogQueue queue(1, LogQueue::Mode::PER_THREAD);
+
+    const size_t writers_count = 8, records_count = 1000;
+    std::vector<std::jthread> writers;
+    for (size_t i = 0; i < writers_count; ++i)
+    {
+        writers.emplace_back([&queue, i]{
+            for (size_t j = 0; j < records_count; ++j)
+            {
+                const auto record = std::to_string(i) + ":" + std::to_string(j);
+                Write(queue, record);
+            }
+        });
+    }
+
+    // records of every writer must come in the order they have been written
+    std::vector<size_t> next(writers_count, 0);
+    for (size_t i = 0; i < writers_count * records_count; ++i)
+    {
+        const auto record = Read(queue);
+        const auto separator = record.find(':');
+        const auto writer = std::stoul(record.substr(0, separator));
+        EXPECT_EQ(std::stoul(record.substr(separator + 1)), next[writer]++);
+    }
+
+    queue.ShutDown();
+    EXPECT_EQ(queue.ReadTo([](const char*, size_t){}), LogQueue::OperationStatus::SHUTDOWN);
+}
+
+
+TEST_F(TestLogQueue, TestDropOnOverflow)
+{
+    const std::string record(MAX_MSG_SIZE, 'r');
+    LogQueue queue(2);
+
+    Write(queue, "first" + record.substr(5)); // two records of MAX_MSG_SIZE fill the queue
+    Write(queue, "second" + record.substr(6));
+    EXPECT_EQ(queue.Write("third", 5, 0, LogQueue::Overflow::DROP_NEWEST), LogQueue::OperationStatus::DROPPED);
+    EXPECT_EQ(queue.Write("fourth", 6, 0, LogQueue::Overflow::DROP_OLDEST), LogQueue::OperationStatus::SUCCESS);
+    EXPECT_EQ(queue.GetDroppedCount(), 2);
+
+    EXPECT_EQ(Read(queue).substr(0, 6), "second");
+    EXPECT_EQ(Read(queue), "fourth");
+
+    EXPECT_EQ(queue.TakeDropped(1h), 2);
+    EXPECT_EQ(queue.Write("fifth", 5, 0, LogQueue::Overflow::DROP_NEWEST), LogQueue::OperationStatus::SUCCESS);
+    EXPECT_EQ(queue.TakeDropped(0s), 0);
+}
+
+
+TEST_F(TestLogQueue, TestStats)
+{
+    const std::string record(MAX_MSG_SIZE, 'r');
+    LogQueue queue(2);
+
+    Write(queue, record); // two records of MAX_MSG_SIZE fill the queue
+    Write(queue, record);
+    auto stats = queue.GetStats();
+    EXPECT_EQ(stats.Enqueued, 2);
+    EXPECT_EQ(stats.Depth, 2);
+
+    std::jthread writer([&queue]{ Write(queue, "blocked"); });
+    while (queue.GetStats().BlockedWrites == 0)
+    {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(1ms); // the writer is waiting for room
+
+    size_t read = 0;
+    while (read < 3)
+    {
+        queue.ReadBatchTo([&read](const char*, size_t){ read++; }, 8, 0us);
+    }
+    writer.join();
+
+    stats = queue.GetStats();
+    EXPECT_EQ(stats.Enqueued, 3);
+    EXPECT_EQ(stats.Depth, 0);
+    EXPECT_EQ(stats.HighWaterDepth, 2);
+    EXPECT_EQ(stats.BlockedWrites, 1);
+    EXPECT_GE(stats.BlockedNanos, std::chrono::nanoseconds(1ms).count());
+    EXPECT_EQ(stats.BatchSizes.Sum, 3);
+    EXPECT_LE(stats.BatchSizes.Percentile(1.0), 3);
+}
+
+
+TEST_F(TestLogQueue, TestSpillKeepsOrder)
+{
+    LogQueue queue(1, LogQueue::Mode::SHARED, 2);
+
+    std::vector<std::string> records;
+    for (int i = 0; i < 4; i++)
+    {
+        records.push_back(std::string(MAX_MSG_SIZE / 2, 'a' + i));
+        EXPECT_EQ(queue.Write(records.back().data(), records.back().size(), 0, LogQueue::Overflow::SPILL), 
+            LogQueue::OperationStatus::SUCCESS);
+    }
+    EXPECT_EQ(queue.GetDroppedCount(), 0);
+
+    EXPECT_EQ(Read(queue), records[0]);
+
+    // there is room in the buffer already, but the record goes after spilled ones
+    const std::string last = "last";
+    EXPECT_EQ(queue.Write(last.data(), last.size(), 0, LogQueue::Overflow::SPILL), LogQueue::OperationStatus::SUCCESS);
+    for (size_t i = 1; i < records.size(); i++)
+    {
+        EXPECT_EQ(Read(queue), records[i]);
+    }
+    EXPECT_EQ(Read(queue), last);
+
+    Write(queue, "blocking write"); // spilled records are drained
+    EXPECT_EQ(Read(queue), "blocking write");
+}
+
+
+TEST_F(TestLogQueue, TestPerThreadMaxRecord)
+{
+    LogQueue queue(1, LogQueue::Mode::PER_THREAD);
+    const std::string record(queue.GetMaxRecordSize(), 'r');
+
+    // record of the whole ring doesn't fit before the end after a short one, it wraps once the reader catches up
+    std::jthread writer([&queue, &record]{
+        Write(queue, "short");
+        Write(queue, record);
+        Write(queue, record);
+    });
+
+    EXPECT_EQ(Read(queue), "short");
+    EXPECT_EQ(Read(queue), record);
+    EXPECT_EQ(Read(queue), record);
+}
+
+TEST_F(TestLogQueue, TestPerThreadDrop)
+{
+    LogQueue queue(1, LogQueue::Mode::PER_THREAD);
+    const std::string record(queue.GetMaxRecordSize(), 'r');
+
+    Write(queue, record);
+    EXPECT_EQ(queue.Write(record.data(), record.size(), 1, LogQueue::Overflow::DROP_OLDEST), LogQueue::OperationStatus::DROPPED);
+    EXPECT_EQ(Read(queue), record);
+    EXPECT_EQ(queue.GetDroppedCount(), 1);
+}
+
+
+TEST_F(TestLogQueue, TestWaitStrategies)
+{
+    for (auto mode : {LogQueue::Mode::SHARED, LogQueue::Mode::PER_THREAD})
+    {
+        for (auto strategy : {LogQueue::WaitStrategy::BLOCK, LogQueue::WaitStrategy::SPIN_THEN_PARK, LogQueue::WaitStrategy::BUSY_SPIN})
+        {
+            LogQueue queue(4, mode);
+            queue.SetWaitStrategy(strategy);
+
+            std::thread writer([&queue]{
+                for (int i = 0; i < 100; i++)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(i % 3 * 100)); // reader spins or parks
+                    Write(queue, std::to_string(i));
+                }
+                queue.ShutDown();
+            });
+
+            std::vector<std::string> records;
+            while (queue.ReadTo([&records](const char* data, size_t size){ records.emplace_back(data, size); }) 
+                == LogQueue::OperationStatus::SUCCESS);
+            writer.join();
+
+            ASSERT_EQ(records.size(), 100);
+            EXPECT_EQ(records.back(), "99");
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#include "thread_specs.hpp"
+
+#if defined(LINUX)
+#    include <pthread.h> // pthread_setaffinity_np, pthread_setname_np
+#    include <sched.h> // sched_setscheduler, SCHED_IDLE
+#    include <sys/resource.h> // setpriority
+#    include <unistd.h> // gettid
+#endif
+
+namespace obps
+{
+
+bool ApplyThreadSpecs(const ThreadSpecs& specs) noexcept
+{
+    bool applied = true;
+#if defined(LINUX)
+    if (! specs.Cpus.empty())
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (const auto cpu : specs.Cpus)
+        {
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+            {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        applied &= ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus) == 0;
+    }
+
+    if (specs.Idle)
+    {
+        const sched_param param{};
+        applied &= ::sched_setscheduler(0, SCHED_IDLE, &param) == 0; // 0: calling thread
+    }
+
+    // nice is per thread on Linux, it has no influence under SCHED_IDLE (see sched(7)), so it is skipped
+    if (specs.Nice && ! specs.Idle)
+    {
+        applied &= ::setpriority(PRIO_PROCESS, ::gettid(), *specs.Nice) == 0;
+    }
+
+    if (! specs.Name.empty())
+    {
+        applied &= ::pthread_setname_np(::pthread_self(), specs.Name.substr(0, 15).c_str()) == 0;
+    }
+#else
+    applied = specs.Cpus.empty() && ! specs.Nice && ! specs.Idle && specs.Name.empty();
+#endif
+    return applied;
+}
+
+void ApplyThreadSpecsOnce(const ThreadSpecsSptr& specs) noexcept
+{
+    // pool thread keeps serving the same task, so the specs are compared by address
+    thread_local const ThreadSpecs* t_Applied = nullptr;
+    if (specs && t_Applied != specs.get())
+    {
+        ApplyThreadSpecs(*specs); // best effort, logging goes on with the default placement
+        t_Applied = specs.get();
+    }
+}
+
+} // namespace obps
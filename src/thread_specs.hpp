@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory> // std::shared_ptr
+#include <optional> // std::optional
+#include <string> // std::string
+#include <vector> // std::vector
+
+namespace obps
+{
+
+// Placement and scheduling of logger threads, keeps them off the cores of latency sensitive threads.
+// Applied by each logger thread to itself before it serves its first batch, on Linux only.
+struct ThreadSpecs
+{
+    std::vector<int> Cpus;      // cpu affinity, empty: any cpu
+    std::optional<int> Nice;    // nice level of the thread, ignored with Idle
+    bool Idle = false;          // SCHED_IDLE: runs only when cpus have nothing else to do
+    std::string Name;           // thread name, truncated to 15 characters
+};
+
+using ThreadSpecsSptr = std::shared_ptr<const ThreadSpecs>;
+
+// Applies specs to the calling thread, returns false if some of them couldn't be applied.
+// Settings that fail (insufficient privileges, offline cpus) are skipped, the others still apply.
+bool ApplyThreadSpecs(const ThreadSpecs& specs) noexcept;
+
+// Applies specs unless they have already been applied to the calling thread.
+void ApplyThreadSpecsOnce(const ThreadSpecsSptr& specs) noexcept;
+
+} // namespace obps
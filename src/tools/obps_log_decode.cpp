@@ -0,0 +1,61 @@
+// Converts binary logs written by outputs with LogBase::BINARY format into text.
+//
+// Usage: obps_log_decode [--json] <binary log> [<text log>]
+//  --json:     use LogBase::JSON format instead of LogBase::default_format
+//  text log:   output file, standard output by default
+
+#include <fstream> // std::ifstream, std::ofstream
+#include <iostream> // std::cout, std::cerr
+#include <stdexcept> // std::runtime_error
+#include <string_view> // std::string_view
+
+#include "binary_format.hpp"
+#include "log_base.hpp"
+
+int main(int argc, char* argv[])
+{
+    auto format = &obps::LogBase::default_format;
+    int arg = 1;
+    if (arg < argc && std::string_view(argv[arg]) == "--json")
+    {
+        format = &obps::LogBase::JSON;
+        arg++;
+    }
+
+    if (arg >= argc || argc - arg > 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--json] <binary log> [<text log>]\n";
+        return 2;
+    }
+
+    std::ifstream in(argv[arg], std::ios::binary);
+    if (! in)
+    {
+        std::cerr << "Failed to open " << argv[arg] << "\n";
+        return 1;
+    }
+
+    std::ofstream file;
+    if (arg + 1 < argc)
+    {
+        file.open(argv[arg + 1]);
+        if (! file)
+        {
+            std::cerr << "Failed to open " << argv[arg + 1] << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = file.is_open() ? file : std::cout;
+
+    try
+    {
+        obps::DecodeBinaryLog(in, out, format);
+    }
+    catch (const std::runtime_error& error)
+    {
+        std::cerr << argv[arg] << ": " << error.what() << "\n";
+        return 1;
+    }
+
+    return out.flush() ? 0 : 1;
+}
@@ -0,0 +1,509 @@
+#include "uring_sink.hpp"
+
+#if defined(IO_URING_SINK)
+
+#include <algorithm> // std::min, std::max
+#include <atomic> // std::atomic_ref
+#include <cerrno> // errno
+#include <cstring> // std::memcpy, std::memset, std::strerror
+#include <format> // std::format
+#include <limits> // std::numeric_limits
+#include <mutex> // std::call_once
+#include <stdexcept> // std::runtime_error
+
+#include <fcntl.h> // open
+#include <linux/io_uring.h> // io_uring_params, io_uring_sqe, io_uring_cqe
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <sys/syscall.h> // __NR_io_uring_*
+#include <sys/uio.h> // iovec
+#include <unistd.h> // syscall, close, pwrite
+
+namespace obps
+{
+
+namespace
+{
+
+// completion of an fdatasync, other operations carry their buffer index
+constexpr uint64_t sync_data = std::numeric_limits<uint64_t>::max();
+
+int IoUringSetup(const unsigned entries, io_uring_params* const params) noexcept
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(const int fd, const unsigned submit, const unsigned min_complete, const unsigned flags) noexcept
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, submit, min_complete, flags, nullptr, 0));
+}
+
+int IoUringRegister(const int fd, const unsigned opcode, const void* const arg, const unsigned count) noexcept
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+bool PwriteAll(const int fd, const char* data, size_t size, off_t offset) noexcept
+{
+    while (size > 0)
+    {
+        const auto written = ::pwrite(fd, data, size, offset);
+        if (written < 0 && errno != EINTR)
+        {
+            return false;
+        }
+
+        if (written > 0)
+        {
+            data += written;
+            size -= written;
+            offset += written;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// Rings are used by a single thread and without SQPOLL, so io_uring_enter consumes
+// all queued entries before it returns and only the tails written by the other side need ordering.
+struct UringSink::Ring
+{
+    explicit Ring(const unsigned entries)
+    {
+        io_uring_params params{};
+        Fd = IoUringSetup(entries, &params);
+        if (Fd < 0)
+        {
+            throw std::runtime_error(std::format("Failed To Set Up io_uring! {}", std::strerror(errno)));
+        }
+
+        SqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        CqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_map)
+        {
+            SqMapSize = CqMapSize = std::max(SqMapSize, CqMapSize);
+        }
+
+        SqMap = ::mmap(nullptr, SqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQ_RING);
+        CqMap = single_map ? SqMap
+            : ::mmap(nullptr, CqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_CQ_RING);
+        SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* const sqes = ::mmap(nullptr, SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQES);
+        Sqes = sqes == MAP_FAILED ? nullptr : static_cast<io_uring_sqe*>(sqes);
+        if (SqMap == MAP_FAILED || CqMap == MAP_FAILED || ! Sqes)
+        {
+            const auto error = errno;
+            Unmap();
+            ::close(Fd);
+            throw std::runtime_error(std::format("Failed To Map io_uring! {}", std::strerror(error)));
+        }
+
+        auto* const sq = static_cast<char*>(SqMap);
+        SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        SqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        SqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        SqEntries = params.sq_entries;
+
+        auto* const cq = static_cast<char*>(CqMap);
+        CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        CqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~Ring()
+    {
+        Unmap();
+        ::close(Fd);
+    }
+
+    void Unmap() noexcept
+    {
+        if (Sqes)
+        {
+            ::munmap(Sqes, SqesSize);
+        }
+        if (CqMap != MAP_FAILED && CqMap != SqMap)
+        {
+            ::munmap(CqMap, CqMapSize);
+        }
+        if (SqMap != MAP_FAILED)
+        {
+            ::munmap(SqMap, SqMapSize);
+        }
+    }
+
+    // caller makes sure that the ring has room for it
+    io_uring_sqe& NextSqe() noexcept
+    {
+        const unsigned tail = *SqTail;
+        const unsigned index = tail & SqMask;
+        auto& sqe = Sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        SqArray[index] = index;
+        std::atomic_ref(*SqTail).store(tail + 1, std::memory_order_release);
+        Queued++;
+        return sqe;
+    }
+
+    // submits queued entries, min_complete: waits for that many completions
+    bool Enter(const unsigned min_complete) noexcept
+    {
+        while (true)
+        {
+            const int submitted = IoUringEnter(Fd, Queued, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+            if (submitted >= 0)
+            {
+                Queued -= std::min<unsigned>(submitted, Queued);
+                return true;
+            }
+            if (errno != EINTR)
+            {
+                return false;
+            }
+        }
+    }
+
+    // takes the next completion, returns false if there is none
+    bool PopCompletion(io_uring_cqe& cqe) noexcept
+    {
+        const unsigned head = *CqHead;
+        if (head == std::atomic_ref(*CqTail).load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        cqe = Cqes[head & CqMask];
+        std::atomic_ref(*CqHead).store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    int Fd = -1;
+    void* SqMap = MAP_FAILED;
+    void* CqMap = MAP_FAILED;
+    size_t SqMapSize = 0;
+    size_t CqMapSize = 0;
+    size_t SqesSize = 0;
+    io_uring_sqe* Sqes = nullptr;
+
+    unsigned* SqTail = nullptr;
+    unsigned* SqArray = nullptr;
+    unsigned SqMask = 0;
+    unsigned SqEntries = 0;
+    unsigned Queued = 0; // entries that are not submitted yet
+
+    unsigned* CqHead = nullptr;
+    unsigned* CqTail = nullptr;
+    unsigned CqMask = 0;
+    io_uring_cqe* Cqes = nullptr;
+};
+
+bool UringSink::Supported() noexcept
+{
+    static std::once_flag checked;
+    static bool supported = false;
+    std::call_once(checked, []{
+        io_uring_params params{};
+        const int fd = IoUringSetup(1, &params);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        // kernel lists the opcodes it supports since 5.6, that is also when IORING_OP_WRITE came
+        constexpr unsigned probe_ops = 256;
+        std::vector<char> probe_buffer(sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op));
+        auto* const probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+        const auto op_supported = [probe](const unsigned op) {
+            return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        };
+        supported = (params.features & IORING_FEAT_NODROP)
+            && IoUringRegister(fd, IORING_REGISTER_PROBE, probe, probe_ops) == 0
+            && op_supported(IORING_OP_WRITE) && op_supported(IORING_OP_FSYNC);
+        ::close(fd);
+    });
+    return supported;
+}
+
+UringSink::UringSink(const std::filesystem::path& path, const size_t buffer_size, const size_t buffers)
+    : m_Fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644))
+    , m_BufferSize(std::max<size_t>(buffer_size, 1))
+    , m_Buffers(new char[m_BufferSize * std::max<size_t>(buffers, 1)])
+    , m_Slots(std::max<size_t>(buffers, 1))
+    , m_Current(no_slot)
+    , m_Offset(0)
+    , m_InFlight(0)
+    , m_Registered(false)
+    , m_Failed(false)
+{
+    struct stat file_stat;
+    if (m_Fd < 0 || ::fstat(m_Fd, &file_stat) != 0)
+    {
+        throw std::runtime_error(std::format("Failed To Open LogFile! with path: {}", path.string()));
+    }
+    m_Offset = file_stat.st_size; // continue existing log from its end
+
+    try
+    {
+        // a write per buffer and a sync for each of them
+        m_Ring = std::make_unique<Ring>(static_cast<unsigned>(m_Slots.size() * 2));
+    }
+    catch (...)
+    {
+        ::close(m_Fd);
+        throw;
+    }
+
+    // registering may fail on a low RLIMIT_MEMLOCK, plain writes are used then
+    std::vector<iovec> iovecs(m_Slots.size());
+    for (size_t slot = 0; slot < m_Slots.size(); slot++)
+    {
+        iovecs[slot] = {Buffer(slot), m_BufferSize};
+    }
+    m_Registered = IoUringRegister(m_Ring->Fd, IORING_REGISTER_BUFFERS, iovecs.data(), static_cast<unsigned>(iovecs.size())) == 0;
+}
+
+UringSink::~UringSink()
+{
+    Flush(false);
+    Wait();
+    m_Ring.reset();
+    ::close(m_Fd);
+}
+
+void UringSink::Write(const char* data, size_t size)
+{
+    Reap(false);
+
+    while (size > 0)
+    {
+        if (m_Current == no_slot)
+        {
+            m_Current = AcquireSlot();
+            if (m_Current == no_slot)
+            {
+                m_Failed = true;
+                return;
+            }
+        }
+
+        auto& slot = m_Slots[m_Current];
+        const size_t chunk = std::min(size, m_BufferSize - slot.Used);
+        std::memcpy(Buffer(m_Current) + slot.Used, data, chunk);
+        slot.Used += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (slot.Used == m_BufferSize)
+        {
+            // full buffer can't take the rest of the data until its write is queued
+            if (! Reserve(1))
+            {
+                return;
+            }
+            QueueSlot(m_Current, false);
+            Submit();
+            m_Current = no_slot;
+        }
+    }
+
+    // the last free buffer keeps collecting batches until one of the writes completes
+    if (m_Current != no_slot && HasFreeSlot() && Reserve(1))
+    {
+        QueueSlot(m_Current, false);
+        Submit();
+        m_Current = no_slot;
+    }
+}
+
+void UringSink::Flush(const bool sync)
+{
+    Reap(false);
+
+    const bool pending = m_Current != no_slot && m_Slots[m_Current].Used > 0;
+    if ((! pending && ! sync) || ! Reserve(pending + sync))
+    {
+        return;
+    }
+
+    if (pending)
+    {
+        QueueSlot(m_Current, sync);
+        m_Current = no_slot;
+    }
+    if (sync)
+    {
+        QueueSync();
+    }
+    Submit();
+}
+
+// submitted writes and syncs are completed, the buffer being filled isn't submitted by it
+void UringSink::Wait()
+{
+    while (m_InFlight > 0 && Reap(true))
+    {}
+}
+
+// Writes in flight are completed by the kernel, the collecting buffer and the data 
+//  are written with plain pwrite calls after them.
+bool UringSink::EmergencyWrite(const char* const data, const size_t size) noexcept
+{
+    if (m_Current != no_slot)
+    {
+        auto& slot = m_Slots[m_Current];
+        m_Failed |= ! PwriteAll(m_Fd, Buffer(m_Current), slot.Used, m_Offset);
+        m_Offset += slot.Used;
+        slot.Used = 0;
+    }
+
+    m_Failed |= ! PwriteAll(m_Fd, data, size, m_Offset);
+    m_Offset += size;
+    return ! m_Failed;
+}
+
+size_t UringSink::AcquireSlot()
+{
+    while (true)
+    {
+        for (size_t slot = 0; slot < m_Slots.size(); slot++)
+        {
+            if (! m_Slots[slot].InFlight)
+            {
+                return slot;
+            }
+        }
+        if (! Reap(true))
+        {
+            return no_slot;
+        }
+    }
+}
+
+bool UringSink::HasFreeSlot() const noexcept
+{
+    for (size_t slot = 0; slot < m_Slots.size(); slot++)
+    {
+        if (slot != m_Current && ! m_Slots[slot].InFlight)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void UringSink::QueueSlot(const size_t index, const bool link)
+{
+    auto& slot = m_Slots[index];
+    slot.Offset = m_Offset;
+    slot.Written = 0;
+    slot.InFlight = true;
+    m_Offset += slot.Used;
+    QueueWrite(index, link);
+}
+
+void UringSink::QueueWrite(const size_t index, const bool link)
+{
+    const auto& slot = m_Slots[index];
+    auto& sqe = m_Ring->NextSqe();
+    sqe.opcode = m_Registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe.fd = m_Fd;
+    sqe.addr = reinterpret_cast<uint64_t>(Buffer(index) + slot.Written);
+    sqe.len = static_cast<uint32_t>(slot.Used - slot.Written);
+    sqe.off = static_cast<uint64_t>(slot.Offset + slot.Written);
+    sqe.buf_index = static_cast<uint16_t>(index);
+    sqe.flags = link ? IOSQE_IO_LINK : 0;
+    sqe.user_data = index;
+    m_InFlight++;
+}
+
+// the sync is linked to the write before it, drain makes it also wait for the writes submitted earlier
+void UringSink::QueueSync()
+{
+    auto& sqe = m_Ring->NextSqe();
+    sqe.opcode = IORING_OP_FSYNC;
+    sqe.fd = m_Fd;
+    sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+    sqe.flags = IOSQE_IO_DRAIN;
+    sqe.user_data = sync_data;
+    m_InFlight++;
+}
+
+void UringSink::Submit()
+{
+    if (! m_Ring->Enter(0))
+    {
+        m_Failed = true;
+    }
+}
+
+bool UringSink::Reserve(const unsigned ops)
+{
+    while (m_InFlight + ops > m_Ring->SqEntries)
+    {
+        if (! Reap(true))
+        {
+            m_Failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool UringSink::Reap(const bool wait)
+{
+    if (wait && ! m_Ring->Enter(1))
+    {
+        return false;
+    }
+
+    bool resubmit = false;
+    io_uring_cqe cqe;
+    while (m_Ring->PopCompletion(cqe))
+    {
+        m_InFlight--;
+        if (cqe.user_data == sync_data)
+        {
+            if (cqe.res == -ECANCELED)
+            {
+                QueueSync(); // linked write was short, sync again after its rest
+                resubmit = true;
+            }
+            else if (cqe.res < 0)
+            {
+                m_Failed = true;
+            }
+            continue;
+        }
+
+        auto& slot = m_Slots[cqe.user_data];
+        if (cqe.res <= 0)
+        {
+            m_Failed = true;
+            slot.Written = slot.Used;
+        }
+        else
+        {
+            slot.Written += cqe.res;
+        }
+
+        if (slot.Written < slot.Used)
+        {
+            QueueWrite(cqe.user_data, false);
+            resubmit = true;
+            continue;
+        }
+        slot = Slot{};
+    }
+
+    if (resubmit)
+    {
+        Submit();
+    }
+    return true;
+}
+
+} // namespace obps
+
+#endif // IO_URING_SINK
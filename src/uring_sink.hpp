@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ObpsLogConfig.hpp"
+
+#if defined(IO_URING_SINK)
+
+#include <filesystem> // std::filesystem::path
+#include <memory> // std::unique_ptr
+#include <vector> // std::vector
+#include <sys/types.h> // off_t
+
+#include "log_sink.hpp"
+
+namespace obps
+{
+
+// Writes to a file with io_uring, so the logger thread doesn't wait for the disk in write().
+// Batches are collected in a set of buffers registered with the ring, a buffer is submitted
+// as soon as another one is free to collect the next batches, so several writes are in flight at once.
+// The thread only waits when all buffers are in flight and the current one is full.
+// Writes carry explicit file offsets, so they keep the order of batches even if they complete out of order.
+// *_SYNC messages submit an fdatasync linked to their write, that also waits for the earlier writes.
+class UringSink final : public LogSink
+{
+public:
+    UringSink(const std::filesystem::path& path, size_t buffer_size, size_t buffers);
+    ~UringSink() override;
+
+    // io_uring is available to the process (kernel 5.6+, not blocked by seccomp)
+    static bool Supported() noexcept;
+
+    void Write(const char* data, size_t size) override;
+    void Flush(bool sync) override;
+    void Wait() override;
+    bool EmergencyWrite(const char* data, size_t size) noexcept override;
+
+    bool Failed() const noexcept override
+    {
+        return m_Failed;
+    }
+
+    // Non-copyable
+    UringSink(const UringSink&) = delete;
+    UringSink& operator=(const UringSink&) = delete;
+
+    // Non-movable
+    UringSink(UringSink&&) = delete;
+    UringSink& operator=(UringSink&&) = delete;
+
+private:
+    // submission and completion rings shared with the kernel
+    struct Ring;
+
+    struct Slot
+    {
+        size_t Used = 0;        // bytes collected in the buffer
+        size_t Written = 0;     // bytes written by completed writes
+        off_t Offset = 0;       // file offset of the buffer
+        bool InFlight = false;
+    };
+
+    static constexpr size_t no_slot = static_cast<size_t>(-1);
+
+    char* Buffer(size_t slot) noexcept
+    {
+        return &m_Buffers[slot * m_BufferSize];
+    }
+
+    // returns a free buffer, waits for a write to complete if there is none
+    size_t AcquireSlot();
+    bool HasFreeSlot() const noexcept;
+
+    // places the buffer at the end of the file and queues its write
+    void QueueSlot(size_t slot, bool link);
+    void QueueWrite(size_t slot, bool link);
+    void QueueSync();
+    void Submit();
+
+    // makes room in the rings for ops more operations
+    bool Reserve(unsigned ops);
+    // processes completed operations, wait: blocks until there is at least one
+    bool Reap(bool wait);
+
+    int m_Fd;
+    std::unique_ptr<Ring> m_Ring;
+    const size_t m_BufferSize;
+    std::unique_ptr<char[]> m_Buffers;
+    std::vector<Slot> m_Slots;
+    size_t m_Current;       // buffer that collects batches, no_slot: none
+    off_t m_Offset;         // end of the file including writes in flight
+    unsigned m_InFlight;    // operations submitted and not completed
+    bool m_Registered;      // buffers are registered, writes use IORING_OP_WRITE_FIXED
+    bool m_Failed;
+};
+
+} // namespace obps
+
+#endif // IO_URING_SINK